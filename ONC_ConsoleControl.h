@@ -27,24 +27,89 @@
   // void printControls(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {}
 
   // example command registration:
-  // registerCommand({"@help","prints available commands or specific command data","@help"DELIMITER"(<command>)",1,0,&printCommandHelp});
+  // registerCommand({"@controls","Prints available console controls","@controls",0,0,&printControls});
 
   //registration format: name (string), description (string), use (string), max parameters (0-255: number of parameters to take in), 
   //min parameters (0-255: number of parameters required to be present), &functionName (function pointer)
 
 
+  // example function taking its parameters as views into the input buffer (no copying, no MAX_PARAMETER_LENGTH limit):
+  // void printCommandHelp(CommandArgs &args) {}
+
+  // example registration (the function goes after an empty function pointer):
+  // registerCommand({"@help","prints available commands or specific command data","@help"DELIMITER"(<command>)",1,0,NULL,&printCommandHelp});
+
+  // a command taking a variable name can say which parameter it is (after the parameter specs), so tab completes variable names there as it does for @get:
+  // registerCommand({"@watch","prints a variable when it changes","@watch"DELIMITER"[<variable>]",1,1,NULL,&watchVariable,false,NULL,1});
+
+  // parameters containing the delimiter can be entered in quotes: @put,name,"1,5"
+  // several commands can be entered on one line: @put,gain,1.5;@put,offset,2
+
+
+  // example registration with the strings kept in flash instead of RAM (worth it on AVR, where literals are copied to RAM):
+  // registerCommand(F("@controls"),F("Prints available console controls"),F("@controls"),0,0,&printControls);
+
+
+  // example compile-time command table (checked for size and order when compiled, searched with a binary search)
+  // the table itself stays in flash; its strings do too if they are PROGMEM arrays and each entry ends with NULL,true
+  // (string literals in it would be copied to RAM on AVR):
+  // constexpr char calibrateName[] PROGMEM = "@calibrate", calibrateDescription[] PROGMEM = "runs the calibration", calibrateUse[] PROGMEM = "@calibrate";
+  // constexpr char statusName[] PROGMEM = "@status", statusDescription[] PROGMEM = "prints the device status", statusUse[] PROGMEM = "@status";
+  // COMMAND_TABLE(myCommands) = {
+  //   {calibrateName,calibrateDescription,calibrateUse,0,0,&calibrate,NULL,true},
+  //   {statusName,statusDescription,statusUse,0,0,&printStatus,NULL,true}, // entries must be in strcmp() order of their names
+  // };
+  // registerCommandTable(myCommands); (in setup(), can be mixed with registerCommand(); a registered command can't have a table command's name)
+
+
   // example eeprom variable registration
   // registerVariable({"relayState",0,MLR_STATE_ADDR});
 
   //format: name (string), type (0 = byte; 1 = double), address (an integer location in EEPROM)
+  // with USE_EEPROM_LOG the address only names the value: values are appended to a wear-leveled log (see "EEPROM log" below)
+
+  // example of an alias (with USE_CONSOLE_ALIASES), which runs several commands when its name is entered:
+  // @alias,prep,"@put,gain,1.5;@put,mode,3;@apply" (more lines of commands can be added to it the same way)
+  // prep (runs the three commands; @alias lists the aliases, @alias,prep,delete deletes it)
+
+  // example of reading a variable from application code (looked up once, then read from RAM):
+  // ConsoleVar<byte> relayState = consoleVar<byte>("relayState"); (in setup(), after eepromBegin())
+  // if (relayState) {...} (in loop(), sees values set with @put)
+
+
+  // example of a long listing, printed a line at a time as the serial port has room for it (so it doesn't block):
+  // bool printLogLine(Print &output, int line) { if (line >= logLength) return false; output.println(logEntries[line]); return true; }
+  // void printLog(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) { startListing(&printLogLine); }
+
+
+  // example of a long-running command as a job (with USE_CONSOLE_JOBS), which runs a step at a time between other work:
+  // JobStatus sweep(Job &job) {
+  //   int &position = job.state<int>(); // (local variables don't survive JOB_YIELD/JOB_SLEEP, job.state does)
+  //   JOB_BEGIN(job);
+  //   for (position = 0; position <= 100 && !job.cancelled; position++) { setPosition(position); JOB_SLEEP(job,50); }
+  //   JOB_END(job);
+  // }
+  // registerJob(F("@sweep"),F("moves through every position"),F("@sweep"),0,0,&sweep); (ctrl-c cancels it, @jobs lists jobs)
+
+
+  // example of a second console on another port (shares the registered commands and variables with the default one):
+  // ConsoleControl<HardwareSerial> maintenanceConsole(Serial2);
+  // maintenanceConsole.poll(); (in loop(), next to consolePoll())
+  // buffer sizes can be set per console with a struct like ConsoleConfig: ConsoleControl<HardwareSerial,SmallConsole>
 
 
 
 
 /* -- -- -- -- -- -- Libraries -- -- -- -- -- -- */
+  #include <errno.h> // out of range numbers in parameters (see parseParameter())
+
   #ifndef NO_EEPROM
   #include <ONC_EEPROM.h> // standard eeprom interface, can be configured for different EEPROMS using definitions
   #endif
+
+  #if defined(CONSOLE_IDLE_SLEEP) && defined(__AVR__)
+  #include <avr/sleep.h> // idle mode while waiting for input (see consoleSleep())
+  #endif
 //
 
 
@@ -61,10 +126,62 @@
 
   //#define USE_DYNAMIC_VAR_ADDRESSES // enable this to automatically pack variables in as compactly as possible. However, the locations may change if you swap libraries/library orders, and most libraries won't know where to find their stuff.
 
+  //#define USE_EEPROM_WRITE_BACK // enable this to hold values from @put in RAM until @commit (or the options below), then write them to EEPROM in as few page writes as possible. @revert discards them.
+  //#define EEPROM_COMMIT_WHEN_IDLE // with USE_EEPROM_WRITE_BACK, also commit when the console session ends
+  //#define EEPROM_WRITE_BLOCK eepromWriteFunction // name of a function (int address, const uint8_t* data, int length) which writes a block within one EEPROM page. If not set, blocks are written one byte at a time with eepromPut
+
+  #ifndef EEPROM_COMMIT_DEADLINE_MS
+  #define EEPROM_COMMIT_DEADLINE_MS 0 // with USE_EEPROM_WRITE_BACK, commit once a value has been waiting this long (0 = only commit with @commit)
+  #endif
+
+  #ifndef EEPROM_PAGE_SIZE
+  #define EEPROM_PAGE_SIZE 32 // bytes per EEPROM page (block writes are split at page boundaries)
+  #endif
+
+  //#define USE_VARIABLE_IMAGE // enable this for @dump and @load, which copy all variables at once as a checksummed hex image (to back up or clone a device); loading holds the image in RAM (MAX_VARIABLES*8+4 bytes)
+
+  //#define USE_EEPROM_LOG // enable this to append values to a log of CRC-checked records spread over the EEPROM_LOG_* region instead of overwriting fixed addresses (wear leveling; with USE_EEPROM_WRITE_BACK each @commit is atomic)
+
+  #ifndef EEPROM_LOG_START
+  #define EEPROM_LOG_START 0 // with USE_EEPROM_LOG, first eeprom address of the log
+  #endif
+
+  #ifndef EEPROM_LOG_SEGMENT_SIZE
+  #define EEPROM_LOG_SEGMENT_SIZE 256 // with USE_EEPROM_LOG, bytes per log segment (a commit is only atomic if its values fit in one)
+  #endif
+
+  #ifndef EEPROM_LOG_SEGMENTS
+  #define EEPROM_LOG_SEGMENTS 4 // with USE_EEPROM_LOG, segments in the log (at least 3); the latest values of all variables must fit in two fewer segments
+  #endif
+
+  //#define USE_CONSOLE_ALIASES // enable this for @alias, which stores named lists of commands in the ALIAS_EEPROM_* region; entering an alias's name runs them
+
+  #ifndef ALIAS_EEPROM_START
+  #ifdef USE_EEPROM_LOG
+  #define ALIAS_EEPROM_START (EEPROM_LOG_START + EEPROM_LOG_SEGMENTS * EEPROM_LOG_SEGMENT_SIZE) // (right after the log)
+  #else
+  #define ALIAS_EEPROM_START 768 // with USE_CONSOLE_ALIASES, first eeprom address of the aliases (no variable or log may use the region)
+  #endif
+  #endif
+
+  #ifndef ALIAS_EEPROM_SIZE
+  #define ALIAS_EEPROM_SIZE 256 // with USE_CONSOLE_ALIASES, bytes of eeprom for the aliases
+  #endif
+
+  #ifdef NO_EEPROM
+  #undef USE_EEPROM_WRITE_BACK
+  #undef USE_EEPROM_LOG
+  #undef USE_CONSOLE_ALIASES
+  #endif
+
   #ifndef MAX_COMMANDS 
   #define MAX_COMMANDS 10 // maximum commands registered at one time
   #endif
 
+  #ifndef MAX_TABLE_COMMANDS
+  #define MAX_TABLE_COMMANDS 128 // maximum commands in a compile-time command table (these don't use RAM, see COMMAND_TABLE)
+  #endif
+
   #ifndef MAX_VARIABLES 
   #define MAX_VARIABLES 10 // maximum variables registered at one time
   #endif
@@ -82,9 +199,15 @@
   #endif
 
   #ifndef COMMAND_HISTORY_LENGTH
-  #define COMMAND_HISTORY_LENGTH 5 // how many previous commands to remember (minimum zero)
+  #define COMMAND_HISTORY_LENGTH 5 // how many full length previous commands to make room for (minimum zero)
+  #endif
+
+  #ifndef HISTORY_ARENA_SIZE
+  #define HISTORY_ARENA_SIZE (COMMAND_HISTORY_LENGTH*INPUT_BUFFER_SIZE) // bytes to store previous commands in (each takes its length + 1, so short commands fit many more)
   #endif
 
+  //#define HISTORY_SKIP_DUPLICATES // enable this to not store a command again if it is the same as the previous one
+
   #ifndef ENTER 
   #define ENTER '\r' // character detected when enter is pressed
   #endif
@@ -105,6 +228,18 @@
   #define LINE_FEED 10 // character sometimes sent in addition to carriage return
   #endif
 
+  #ifndef TAB
+  #define TAB '\t' // character detected when tab is pressed (completes command and variable names)
+  #endif
+
+  #ifndef CANCEL
+  #define CANCEL 3 // character detected when ctrl-c is pressed (cancels the foreground jobs, or the line being entered)
+  #endif
+
+  //#define NO_PARAMETER_SPECS // enable this to leave out checking and converting parameters with parameter specs (see ParameterSpec), which uses strtol() and strtod()
+
+  //#define NO_TAB_COMPLETION // enable this to leave out tab completion (saves MAX_COMMANDS bytes of RAM); tabs are then entered like other characters
+
   #ifndef ENTRY_PREFIX 
   #define ENTRY_PREFIX '>' // thing to show up before command to signify user can input a command
   #endif
@@ -113,731 +248,5058 @@
   #define DELIMITER "," // character by which to split the input strings
   #endif 
 
+  #ifndef QUOTE
+  #define QUOTE '"' // character used to enclose parameters which contain the delimiter
+  #endif
+
+  #ifndef COMMAND_SEPARATOR
+  #define COMMAND_SEPARATOR ';' // character separating several commands entered on one line (run in order)
+  #endif
+
   #ifndef ESC_CODE_MS
-  #define ESC_CODE_MS 2 // time to wait to see if an escape sequence is sent after an escape character is sent
+  #define ESC_CODE_MS 2 // time without input after an escape character for it to count as escape pressed alone (instead of the start of an escape sequence)
   #endif
 
   #ifndef MAX_ESC_CODE_LENGTH
-  #define MAX_ESC_CODE_LENGTH 2 // maximum characters in an escape sequence to be parsed (any number can be ignored)
+  #define MAX_ESC_CODE_LENGTH 8 // maximum characters after "escape [" for a sequence to be run (longer ones are read in and ignored)
   #endif
   
   #ifndef CONSOLE_CONTROL_TIMEOUT_MS
   #define CONSOLE_CONTROL_TIMEOUT_MS 30000
   #endif
 
+  #ifndef OUTPUT_BUFFER_SIZE
+  #define OUTPUT_BUFFER_SIZE (INPUT_BUFFER_SIZE+16) // bytes of console output collected before sending (enough for redrawing a full line)
+  #endif
 
+  //#define OUTPUT_BLOCKING // enable this if SERIAL_INTERFACE doesn't implement availableForWrite(); output is then sent without checking for room
 
+  //#define NO_INSERT_DELETE_CODES // enable this if the terminal doesn't support the insert/delete character codes (escape [@ and escape [P); edits inside the line then redraw the rest of it
 
-  /* -- -- -- -- -- -- Data Types -- -- -- -- -- -- */
+  #ifndef CONSOLE_POLL_MAX_BYTES
+  #define CONSOLE_POLL_MAX_BYTES 16 // maximum characters handled per consolePoll() call (limits time spent per call)
+  #endif
 
-  // holds the information needed for a serial command
-  struct Command {
-    char* name;
-    char* description;
-    char* use;
-    uint8_t maxParameters;
-    uint8_t minParameters;
-    void (*function)(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
-  };
+  #ifndef CONSOLE_POLL_MAX_LINES
+  #define CONSOLE_POLL_MAX_LINES 4 // maximum lines of a listing printed per consolePoll() call (see startListing())
+  #endif
 
+  #ifndef LISTING_PAGE_LINES
+  #define LISTING_PAGE_LINES 0 // lines of a listing printed before waiting for a key (space to go on, q or ctrl-c to stop); 0 = no pager
+  #endif
 
-  #ifndef NO_EEPROM
-  // allows storing/reading from eeprom based on variable name
-  struct eepromVariable {
-    char* name;
-    uint8_t type; // 0 = byte; 1 = double
-    int address;
-    bool modified;
-  };
+  #ifndef CONSOLE_RX_BUFFER_SIZE
+  #define CONSOLE_RX_BUFFER_SIZE 64 // bytes of received input the library holds on top of the serial driver's buffer (catches pasted text while commands run)
   #endif
 
+  #ifndef CONSOLE_ECHO_SKIP_BYTES
+  #define CONSOLE_ECHO_SKIP_BYTES (CONSOLE_RX_BUFFER_SIZE/4) // a line which starts with more than this many received bytes waiting isn't echoed (input of a paste comes before its echo); 0 = always echo
+  #endif
 
-  // -- console control variables --/
+  //#define CONSOLE_RAM_REPORT // enable this to have the compiler list the library's static RAM use (as a warning) when compiling
+  //#define CONSOLE_RAM_BUDGET 1024 // set this to make compiling fail if the library's static RAM use goes over this many bytes
 
-  Command commands[MAX_COMMANDS]; // list to hold commands
-  
-  int commandNum = 0; // command counter
+  //#define CONSOLE_IDLE_SLEEP // enable this to sleep while runSerialCommands() waits for input (AVR idle mode, or wait-for-interrupt on ARM); a received byte or the millis() tick wakes it (see consoleIdleHook)
 
+  //#define CONSOLE_RECEIVE_IN_YIELD // enable this to define yield() as consoleYield(), so input keeps being received during delay() in commands (only if nothing else defines yield())
 
+  //#define USE_CONSOLE_JOBS // enable this for commands which run as jobs, a step at a time between other work (see registerJob()); @jobs lists them and ctrl-c cancels them
 
-  #ifndef NO_EEPROM
-  eepromVariable variables[MAX_VARIABLES]; // place to declare eeprom variables
+  #ifndef MAX_JOBS
+  #define MAX_JOBS 2 // with USE_CONSOLE_JOBS, maximum jobs running at one time
+  #endif
 
-  int variableNum = 0; // how many variables have been registered
-  int nextAddress = 0; // if using automatic variable address assignment, the next available address
+  #ifndef JOB_STATE_SIZE
+  #define JOB_STATE_SIZE 16 // with USE_CONSOLE_JOBS, bytes each job has for its own variables (see Job::state())
+  #endif
 
+  #ifndef JOB_TEXT_SIZE
+  #define JOB_TEXT_SIZE 32 // with USE_CONSOLE_JOBS, bytes each job has for a copy of its parameters
+  #endif
 
+  //#define USE_CONSOLE_STATS // enable this to keep run counts, run times and output sizes of commands, and the time spent in the console, shown with @stats
 
-  static const char* typeNames[] = {"byte","double"}; //names of each variable type
-  static const uint8_t typeSizes[] = {sizeof(uint8_t),sizeof(double)}; // sizes of variable types
-  static const int typeNum = sizeof(typeNames)/sizeof(char*); // how many types there are
+  #ifndef CONSOLE_STATS_TABLE_COMMANDS
+  #define CONSOLE_STATS_TABLE_COMMANDS 8 // with USE_CONSOLE_STATS, how many command table commands statistics are kept for (by default)
+  #endif
 
+  #ifndef CONSOLE_STATS_COMMANDS
+  #define CONSOLE_STATS_COMMANDS (MAX_COMMANDS + CONSOLE_STATS_TABLE_COMMANDS) // with USE_CONSOLE_STATS, how many commands statistics are kept for (registered commands first, then command table commands)
   #endif
 
 
-  char historyBuffers[COMMAND_HISTORY_LENGTH+1][INPUT_BUFFER_SIZE]; // input buffer memory (for recalling past commands)
-  int inputEnds[COMMAND_HISTORY_LENGTH+1]; // how many characters in each buffer actually have been entered
+  //#define USE_BINARY_PROTOCOL // enable this for the framed binary mode used by scripts (see the Binary protocol section at the end); entered with @binary, or by sending a frame when no session is running
 
-  char inputBuffer[INPUT_BUFFER_SIZE]; // the main input buffer
-//
+  #ifndef BINARY_FRAME_SIZE
+  #define BINARY_FRAME_SIZE 64 // maximum payload bytes of a binary frame, request or response (up to 255)
+  #endif
 
+  #ifndef BINARY_FRAME_START
+  #define BINARY_FRAME_START 0xA5 // first byte of every binary frame
+  #endif
 
+  #ifndef BINARY_BYTE_TIMEOUT_MS
+  #define BINARY_BYTE_TIMEOUT_MS 50 // an unfinished binary frame is dropped after this long without another byte
+  #endif
 
 
 
 
+  /* -- -- -- -- -- -- Data Types -- -- -- -- -- -- */
 
+  // a parameter converted as described by its ParameterSpec
+  union ParameterValue {
+    long asInt; // PARAMETER_INT
+    uint8_t asByte; // PARAMETER_BYTE
+    double asDouble; // PARAMETER_DOUBLE
+    uint8_t asChoice; // PARAMETER_CHOICE: position of the word in the choices (0 = first)
+  };
 
-/* -- -- -- -- -- -- Functions -- -- -- -- -- -- */
 
+  // parameters given to a command, as null terminated strings inside the input buffer
+  // values past count point to an empty string
+  struct CommandArgs {
+    uint8_t count; // how many parameters were entered
+    char* values[MAX_PARAMETERS];
+    uint8_t lengths[MAX_PARAMETERS]; // (a parameter is never longer than the line, see INPUT_BUFFER_SIZE)
+    #ifndef NO_PARAMETER_SPECS
+    ParameterValue parsed[MAX_PARAMETERS]; // for commands with parameter specs, the entered parameters already checked and converted
+    #endif
+  };
 
 
+  // what a parameter must be (see ParameterSpec)
+  enum ParameterType : uint8_t {
+    PARAMETER_STRING, // any text
+    PARAMETER_INT, // whole number
+    PARAMETER_BYTE, // whole number from 0 to 255
+    PARAMETER_DOUBLE, // number
+    PARAMETER_CHOICE // one of a list of words
+  };
 
-// registers a new command which can then be run via serial
-// takes a Command object which stores all the necessary data
-// the object can be represented by an initializer list
-void registerCommand(Command command) {
-  if (commandNum < MAX_COMMANDS) {
-    commands[commandNum] = command;
-    commandNum++;
-  } else {
-    SERIAL_INTERFACE.println("Out of space for commands. Change MAX_COMMANDS or register less commands.");
-  }
-}
 
+  // one end of the range of a number parameter: a long for PARAMETER_INT and PARAMETER_BYTE (so every bound is exact), a float for PARAMETER_DOUBLE
+  union ParameterBound {
+    long asInt;
+    float asDouble;
 
-#ifndef NO_EEPROM
-// registers a new variable for use with EEPROM
-// takes a eepromVariable object which stores all the necessary data
-// the address field will be ignored (it is set by this function)
-// the object can be represented by an initializer list
-void registerVariable(eepromVariable variable) {
-  
-  if (variableNum < MAX_VARIABLES) {
+    constexpr ParameterBound() : asInt(0) {}
+    constexpr ParameterBound(long value) : asInt(value) {}
+    constexpr ParameterBound(double value) : asDouble(value) {}
+  };
 
-    #ifdef USE_DYNAMIC_VAR_ADDRESSES
-    variable.address = nextAddress;
-    nextAddress += typeSizes[variable.type];
-    #endif
 
-    variable.modified = false;
+  // describes a command parameter, so the dispatcher can check and convert it before the command runs
+  // commands registered with a list of them (one per parameter) find the results in CommandArgs::parsed
+  // made with the macros below: {INT_PARAMETER(1,10),CHOICE_PARAMETER("on|off")}
+  struct ParameterSpec {
+    ParameterType type;
+    bool ranged; // whether a number must be from min to max (otherwise any number, or 0 to 255 for PARAMETER_BYTE)
+    ParameterBound min;
+    ParameterBound max;
+    const char* choices; // PARAMETER_CHOICE: the words, separated by '|'
+  };
 
-    variables[variableNum] = variable;
-    variableNum++;
+  #define STRING_PARAMETER {PARAMETER_STRING,false,ParameterBound(),ParameterBound(),NULL}
+  #define INT_PARAMETER(min,max) {PARAMETER_INT,true,ParameterBound((long)(min)),ParameterBound((long)(max)),NULL}
+  #define BYTE_PARAMETER(min,max) {PARAMETER_BYTE,true,ParameterBound((long)(min)),ParameterBound((long)(max)),NULL}
+  #define DOUBLE_PARAMETER(min,max) {PARAMETER_DOUBLE,true,ParameterBound((double)(min)),ParameterBound((double)(max)),NULL}
+  #define ANY_INT_PARAMETER {PARAMETER_INT,false,ParameterBound(),ParameterBound(),NULL}
+  #define ANY_BYTE_PARAMETER {PARAMETER_BYTE,false,ParameterBound(),ParameterBound(),NULL}
+  #define ANY_DOUBLE_PARAMETER {PARAMETER_DOUBLE,false,ParameterBound(),ParameterBound(),NULL}
+  #define CHOICE_PARAMETER(choices) {PARAMETER_CHOICE,false,ParameterBound(),ParameterBound(),choices}
 
-  } else {
 
-    SERIAL_INTERFACE.println("Out of space for variables. Change MAX_VARIABLES or register less variables.");
-  }
-}
-#endif
+  // holds the information needed for a serial command
+  // only one of function and argsFunction should be set
+  #ifdef USE_CONSOLE_JOBS
+  class ConsoleBase;
+  struct Job;
+
+  // what a job's step function returns
+  enum JobStatus : uint8_t {
+    JOB_RUNNING, // call it again
+    JOB_DONE // finished
+  };
+  #endif
 
 
-#ifndef NO_EEPROM
-void getVariable(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
-void putVariable(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
-void printVariables(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
-#endif
-void printCommandHelp(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
-void printControls(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
-// format: void functionName(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+  struct Command {
+    const char* name;
+    const char* description;
+    const char* use;
+    uint8_t maxParameters;
+    uint8_t minParameters;
+    void (*function)(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]); // takes copies of the parameters (truncated to MAX_PARAMETER_LENGTH-1 characters)
+    void (*argsFunction)(CommandArgs &args); // takes the parameters in place
+    bool flashStrings; // whether name, description and use (and parameterSpecs) are in flash (PROGMEM) instead of RAM
+    const ParameterSpec* parameterSpecs; // if set, one for each of the maxParameters parameters (see ParameterSpec)
+    uint8_t variableParameter; // if set, which parameter (from 1) is a variable name, so tab completes variable names there
+    #ifdef USE_CONSOLE_JOBS
+    JobStatus (*jobFunction)(Job &job); // if set, the command runs as a job, with this called for each step (see registerJob())
+    #endif
+  };
 
 
-// initialize the default commands (allows selective inclusion of default commands using macros)
-void registerDefaultCommands() {
-  #ifndef NO_EEPROM
-  registerCommand({"@get","reads a variable from EEPROM","@get"DELIMITER"[<variable>]",1,1,&getVariable});
-  registerCommand({"@put","stores a variable in EEPROM","@put"DELIMITER"[<variable>]"DELIMITER"[<value>]",2,2,&putVariable});
-  registerCommand({"@variables","prints all eeprom variables and their types","@variables",0,0,&printVariables});
-  #endif
+  #ifdef USE_CONSOLE_JOBS
+  // a command running a step at a time: each poll() of the console it was started from calls its step function once
+  // the step function does a slice of the work and returns JOB_RUNNING, until it returns JOB_DONE
+  // the JOB_ macros below let it be written as ordinary code which gives up control where it yields
+  struct Job {
+    bool running; // whether this slot holds a job
+    bool foreground; // whether ctrl-c on its console cancels it
+    bool cancelled; // set when it is cancelled; the step function is called once more (to clean up), then the job ends
+    int commandIndex;
+    ConsoleBase* console; // console it was started from, which its output goes to
+    uint16_t resumeLine; // where the step function carries on (set by JOB_YIELD)
+    unsigned long wakeMs; // millis() when it carries on after JOB_SLEEP
+    unsigned long startMs;
+    unsigned long steps;
+    unsigned long busyMicros; // time spent in the step function
+    CommandArgs args; // its parameters (copied into text, as the input buffer is reused)
+    char text[JOB_TEXT_SIZE];
+
+    // the job's own variables, which keep their values between steps: MyState &state = job.state<MyState>(); (zeroed when it starts)
+    template <typename T>
+    T &state() {
+      static_assert(sizeof(T) <= JOB_STATE_SIZE, "Job state is larger than JOB_STATE_SIZE.");
+      return *reinterpret_cast<T*>(stateData.bytes);
+    }
 
-  registerCommand({"@help","prints available commands or specific command data","@help"DELIMITER"(<command>)",1,0,&printCommandHelp});
-  registerCommand({"@controls","Prints available console controls","@controls",0,0,&printControls});
+  private:
+    union { uint8_t bytes[JOB_STATE_SIZE]; long alignLong; double alignDouble; } stateData;
+  };
 
-}
 
+  // step function helpers (protothread style): JOB_BEGIN(job); ...code with JOB_YIELD(job) and JOB_SLEEP(job,ms)...; JOB_END(job);
+  // each yield returns from the step function, and the next step carries on after it
+  // local variables don't keep their values across a yield (keep them in job.state<T>()), a yield can't be inside a switch statement,
+  // and only one yield fits on a line
+  #define JOB_BEGIN(job) switch ((job).resumeLine) { case 0:
+  #define JOB_YIELD(job) do { (job).resumeLine = __LINE__; return JOB_RUNNING; case __LINE__:; } while (0)
+  #define JOB_SLEEP(job,ms) do { (job).wakeMs = millis() + (ms); JOB_YIELD(job); } while (0)
+  #define JOB_END(job) } return JOB_DONE
+  #endif
 
-// takes the characters up to the next space or ending character in an input string
-// made to be used in runSerialCommands()
-// inputNum is the token index to find (0=first token, 1=second, etc.)
-// if inputNum is lower than 0, the function will not do anything.
-// stores the characters in 'token' if they exist, otherwise stores NULL in position 0
-void getToken(char (&token)[MAX_PARAMETER_LENGTH], char (&input)[INPUT_BUFFER_SIZE], int tokenNum) {
-  
-  if (tokenNum < 0) return;
 
-  if (input[0] == '\0') {
-    token[0] = '\0';
-    return;
-  }
+  // progress through an incoming escape sequence
+  enum EscapeState : uint8_t {
+    ESC_STATE_NONE, // not in an escape sequence
+    ESC_STATE_STARTED, // escape received, waiting to see if a sequence follows
+    ESC_STATE_CSI, // reading a control sequence ("escape [")
+    ESC_STATE_SS3 // waiting for the character after "escape O"
+  };
 
-  //SERIAL_INTERFACE.println("got past empty check in getToken");
-  //SERIAL_INTERFACE.println((int)input[0]);
 
-  int i = 1;
-  int start = 0;
+  // a running total of time, in milliseconds and the microseconds left over
+  // (a total in microseconds would wrap after about 71 minutes; this one lasts about 49 days)
+  struct TimeTotal {
+    unsigned long ms;
+    unsigned long micros; // under 1000 between calls to add()
 
-  for (;i < INPUT_BUFFER_SIZE-1 && input[i] != '\0'; i++) {
-    
-    if ((input[i] == DELIMITER[0]) && (input [i-1] != DELIMITER[0])) {
-    
-      if (tokenNum == 0) break;
-      else {
-        tokenNum = tokenNum-1;
-      }
-    } else if ((input[i] != DELIMITER[0]) && (input [i-1] == DELIMITER[0])) {
+    void add(unsigned long elapsedMicros) {
+      micros += elapsedMicros;
+      if (micros < 1000) return; // (no division on most calls)
 
-      start = i;
+      ms += micros / 1000;
+      micros %= 1000;
     }
-  }
-
-  //SERIAL_INTERFACE.print(start);
-  //SERIAL_INTERFACE.print('-');
-  //SERIAL_INTERFACE.println(i);
-
-  //SERIAL_INTERFACE.println(tokenNum);
-  if (tokenNum > 0) { 
-    token[0] = '\0';
-    return;
-  }
+  };
 
-  //if (input[i] == '\0') i = i-1;
 
-  
-  int j = 0;
-  
-  for (; j < i-start && j < MAX_PARAMETER_LENGTH; j++) {
-    
-    token[j] = input[j+start];
-  }
+  // counters for the receive buffer
+  struct RxStats {
+    unsigned long received; // bytes taken from the serial interface
+    unsigned long overflows; // bytes lost because the receive buffer was full
+    int highWater; // most bytes ever waiting in the receive buffer
+  };
 
-  token[j] = '\0';
-  //SERIAL_INTERFACE.println(j);
-  //SERIAL_INTERFACE.println(token);
-}
 
+  #ifdef USE_CONSOLE_STATS
+  // statistics of one command (see @stats)
+  struct CommandStats {
+    unsigned long calls;
+    unsigned long minMicros; // shortest run
+    unsigned long maxMicros; // longest run
+    unsigned long totalMicros; // all runs together (mean = totalMicros / calls)
+    unsigned long bytesWritten; // output printed through consoleOutput
+    unsigned int parseFailures; // times it was given too few parameters
+  };
 
-// returns the index of the given command in the command list if it is valid, otherwise returns an index one past the end of the list
-int findAndCheckCommandIndex(char (&command)[MAX_PARAMETER_LENGTH]) {
-  int commandIndex = 0;
-  for(; commandIndex < commandNum && strcmp(command,commands[commandIndex].name) != 0; commandIndex++);
-  
-  if (commandIndex == commandNum) {
-    SERIAL_INTERFACE.print('\'');
-    SERIAL_INTERFACE.print(command);
-    SERIAL_INTERFACE.println("' is not a command. You can use the '@help' command to list all possible commands.");
-  }
+  // statistics of the console as a whole
+  struct ConsoleStats {
+    unsigned long keystrokes; // characters handled in terminal sessions
+    unsigned long unknownCommands;
+    unsigned long redraws; // edits and history recalls which changed text already on screen
+    unsigned long redrawBytes; // bytes sent for them
+    TimeTotal consoleTime; // time spent in poll()
+    unsigned long sinceMs; // millis() when the statistics were last reset
+  };
+  #endif
 
-  return commandIndex;
 
-}
+  void consoleYield();
 
 
-#ifndef NO_EEPROM
-// returns the index of the given variable in the variable list if it is valid, otherwise returns an index one past the end of the list
-int findAndCheckVariableIndex(char (&variable)[MAX_PARAMETER_LENGTH]) {
-  int variableIndex = 0;
-  for(; variableIndex < variableNum && strcmp(variable,variables[variableIndex].name) != 0; variableIndex++);
-  
-  if (variableIndex == variableNum) {
-    SERIAL_INTERFACE.print('\'');
-    SERIAL_INTERFACE.print(variable);
-    SERIAL_INTERFACE.println("' is not a variable. You can use the '@variables' command to list all variables.");
-  }
+  // print target which fills a fixed block of memory, dropping whatever doesn't fit
+  class TextBuffer : public Print {
+  public:
+    TextBuffer(char* text, int size) : text(text), size(size) {}
 
-  return variableIndex;
+    using Print::write;
 
-}
-#endif
+    size_t write(uint8_t value) {
+      if (length == size) {
+        truncated = true;
+        return 0;
+      }
 
-// copies the contents of one char buffer to another char buffer
-void bufferCopy(char (&buffer1)[INPUT_BUFFER_SIZE], char (&buffer2)[INPUT_BUFFER_SIZE]) {
+      text[length++] = value;
+      return 1;
+    }
 
-  for (int i = 0; i < INPUT_BUFFER_SIZE; i++) buffer1[i] = buffer2[i];
-}
+    char* text;
+    int size;
+    int length = 0;
+    bool truncated = false; // whether anything was dropped
+  };
 
 
-// shifts the buffer history up and copies the last used buffer to the new entry if necessary
-// requires the index in the buffer list of the last used command
-void incrementBufferHistory(int historyIndex) {
+  // collects console output so it can be sent with as few write() calls (serial transactions) as possible
+  // output is held until flush() (sends everything) or flushAvailable() (sends what fits without blocking) is called,
+  // or until the buffer fills up, in which case it is sent even if that blocks
+  // a stream which never reports room (Print's default availableForWrite() returns 0, as with SoftwareSerial) gets everything at once, as with OUTPUT_BLOCKING
+  template <typename StreamType, int bufferSize>
+  class ConsoleWriter : public Print {
+  public:
+    ConsoleWriter(StreamType &stream) : stream(stream) {}
 
-  bufferCopy(historyBuffers[0],inputBuffer);
-  inputEnds[0] = inputEnds[historyIndex];
+    unsigned long flushes = 0; // write() calls made on the serial interface
+    unsigned long bytesSent = 0; // bytes sent to the serial interface
+    unsigned long blockingFlushes = 0; // times the buffer was full and had to be sent regardless of room
 
-  for (int i = COMMAND_HISTORY_LENGTH; i > 0; i--) {
-    bufferCopy(historyBuffers[i],historyBuffers[i-1]);
-    inputEnds[i] = inputEnds[i-1];
-  }
+    using Print::write;
 
+    size_t write(uint8_t value) {
+      put(value);
+      return 1;
+    }
 
-  /*if (historyIndex != 1) {
+    // while set, echo() drops what it is given instead of adding it (see ConsoleControl::startNewLine())
+    bool skipEcho = false;
+    unsigned long echoSkipped = 0; // bytes echo() has dropped since it was last reported
 
-    if (historyIndex > 0) {
-      bufferCopy(historyBuffers[0],historyBuffers[historyIndex]);
-      inputEnds[0] = inputEnds[historyIndex];
+    // add echo of the line being entered, without going through Print, whose print() calls the virtual write() for every byte
+    void echo(char value) {
+      if (skipEcho) echoSkipped++;
+      else put(value);
     }
-    
 
-    for (int i = COMMAND_HISTORY_LENGTH; i > 0; i--) {
-      bufferCopy(historyBuffers[i],historyBuffers[i-1]);
-      inputEnds[i] = inputEnds[i-1];
+    void echo(const char* text) {
+      while (*text) echo(*text++);
     }
-  }*/
-}
 
+    void echo(const __FlashStringHelper* text) {
+      PGM_P p = (PGM_P)text;
+      while (char c = pgm_read_byte(p++)) echo(c);
+    }
 
-// prints the buffer at the given history location to the current line after clearing it
-void printHistoryBuffer(int historyIndex, int &inputIndex) {
+    // add output (what write() does, without the virtual call)
+    void put(char value) {
+      if (length == bufferSize) {
+        flushAvailable(); // make room by sending what the serial interface has room for, if it can
 
-  SERIAL_INTERFACE.print("\u001b[2K\r");
-  
-  SERIAL_INTERFACE.print(ENTRY_PREFIX);
+        if (length == bufferSize) {
+          blockingFlushes++;
+          flush();
+        }
+      }
 
-  for (int i = 0; i < inputEnds[historyIndex]; i++) {
-    SERIAL_INTERFACE.print(historyBuffers[historyIndex][i]);
-  }
+      buffer[length++] = value;
+    }
 
-  inputIndex = inputEnds[historyIndex];
+    size_t write(const uint8_t* data, size_t size) {
+      for (size_t i = 0; i < size; i++) write(data[i]);
+      return size;
+    }
 
-  //inputIndex = min(inputEnds[historyIndex],inputIndex);
+    // sends everything collected, waiting if the serial interface is busy
+    // (input keeps being received while waiting, unless OUTPUT_BLOCKING is set)
+    void flush() {
+      #ifdef OUTPUT_BLOCKING
+      send(length);
+      #else
+      while (length > 0) {
+        send(min(length,room()));
+        if (length > 0) consoleYield();
+      }
+      #endif
+    }
 
-  //SERIAL_INTERFACE.print("\u001b[");
-  //SERIAL_INTERFACE.print(inputEnds[historyIndex] - inputIndex);
-  //SERIAL_INTERFACE.print('D');
-}
+    // sends as much as the serial interface can take without blocking; the rest is kept for the next call
+    void flushAvailable() {
+      #ifdef OUTPUT_BLOCKING
+      send(length);
+      #else
+      send(min(length,room()));
+      #endif
+    }
 
+    // how many bytes are waiting to be sent
+    int pending() {
+      return length;
+    }
 
-// filters unwanted escape sequences from echoing, and implements escape sequences which are wanted
-// returns whether an escape sequence was detected
-// takes the current input position in the input buffer
-bool catchEscapeSequence(int &historyIndex, int &inputIndex, bool allowHistory = false) {
+    // whether the serial interface has room for what is waiting and half its transmit buffer more
+    // (judged by the most room it has reported), so a line or so more can be written without blocking
+    bool ready() {
+      #ifdef OUTPUT_BLOCKING
+      return length < bufferSize / 2;
+      #else
+      int room = stream.availableForWrite();
+      if (room > 0) roomReported = true;
+      if (!roomReported) return true; // (everything goes at once, see room())
+      if (room > mostRoom) mostRoom = room;
+      return room - length >= mostRoom / 2;
+      #endif
+    }
 
+    // bytes written so far, sent or not
+    unsigned long bytesWritten() {
+      return bytesSent + length;
+    }
 
-  char escapeSequence[MAX_ESC_CODE_LENGTH];
-  //int escapeIndex = 0;
+  private:
+    StreamType &stream;
+    uint8_t buffer[bufferSize];
+    int length = 0;
+    #ifndef OUTPUT_BLOCKING
+    int mostRoom = 0; // most room the serial interface has reported to ready() (about the size of its transmit buffer)
+    bool roomReported = false; // whether availableForWrite() has ever returned more than 0
+
+    // room the serial interface has for output
+    // until it has reported any, it is taken to have room for everything (so a stream without availableForWrite() blocks in write() instead of never being sent to)
+    int room() {
+      int room = stream.availableForWrite();
+      if (room > 0) roomReported = true;
+      return roomReported ? room : length;
+    }
+    #endif
 
-  // read in sequence to parse
-  for (int escapeIndex = 0; escapeIndex < MAX_ESC_CODE_LENGTH && SERIAL_INTERFACE.available(); escapeIndex++) {
-    escapeSequence[escapeIndex] = SERIAL_INTERFACE.read();
-    delay(ESC_CODE_MS);
-  }
+    // sends the first count bytes of the buffer in a single write() and keeps the rest
+    void send(int count) {
+      if (count <= 0) return;
 
-  // get rid of any remaining characters (in case of overly long sequence)
-  while (SERIAL_INTERFACE.available()) {
-    SERIAL_INTERFACE.read();
-    delay(ESC_CODE_MS);
-  }
+      stream.write(buffer,count);
+      flushes++;
+      bytesSent += count;
 
+      length -= count;
+      memmove(buffer,buffer+count,length);
+    }
+  };
 
-  // parse escape sequences
-  if (escapeSequence[0] == '[') {
 
-    if (escapeSequence[1] == 'C' && inputIndex != inputEnds[historyIndex]) { // "[C" (move cursor right)
-      SERIAL_INTERFACE.print("\u001b[C");
+  // a listing being printed a line at a time, between polls (see startListing())
+  struct Listing {
+    bool (*printLine)(Print &output, int line); // prints one line; returns false once there are no more (NULL = no listing)
+    int line; // next line to print
+    uint8_t pageLines; // lines printed since the pager last waited
+    bool paused; // whether the pager is waiting for a key
+  };
 
-      inputIndex++;
-      inputEnds[historyIndex] = max(inputEnds[historyIndex],inputIndex);
-      
-    }
 
-    else if (escapeSequence[1] == 'D' && inputIndex > 0) { // "[D" (move cursor left)
-      SERIAL_INTERFACE.print("\u001b[D");
-      inputIndex--;
-    }
+  // what the shared code needs from a console, whatever its stream and configuration (see ConsoleControl)
+  // only used off the per-character path: to reach the console running a command, and by consoleYield()
+  class ConsoleBase {
+  public:
+    ConsoleBase() : next(first) { first = this; }
 
-    else if (escapeSequence[1] == 'A' && allowHistory && historyIndex < COMMAND_HISTORY_LENGTH) { // "[A" (up arrow, recall further back in history)
-      
-      if(historyIndex == 0) {
-        bufferCopy(historyBuffers[0],inputBuffer);
-      }
- 
-      historyIndex++;
-      
-      printHistoryBuffer(historyIndex,inputIndex);
-      bufferCopy(inputBuffer,historyBuffers[historyIndex]);
-    }
+    TimeTotal activeTime = {0,0}; // time spent handling input and running commands
+    TimeTotal idleTime = {0,0}; // time a session spent waiting for input
 
-    else if (escapeSequence[1] == 'B' && allowHistory && historyIndex > 0) { // "[B" (down arrow, recall less far back in history)
-      
-      historyIndex--;
-      printHistoryBuffer(historyIndex,inputIndex);
-      bufferCopy(inputBuffer,historyBuffers[historyIndex]);
-    }
-  }
-}
+    char delimiter = DELIMITER[0]; // parameter delimiter (the console's Config::delimiter)
 
+    Listing listing = {NULL,0,0,false}; // listing being printed (see startListing())
+    bool runningLine = false; // whether the commands of an entered line are running (only they can start a listing)
 
+    virtual void receive() = 0; // takes in what the stream has received
+    virtual Print &writer() = 0; // where the console's output goes
+    #ifdef USE_BINARY_PROTOCOL
+    virtual void startBinary() = 0; // switches the session to the binary protocol
+    #endif
 
+    static ConsoleBase* first; // every console, linked through next
+    ConsoleBase* next;
+  };
 
-// allows the user to enter text
-bool getSerialInput(int &historyIndex, bool allowHistory = false, bool timeout = true) {
-  
-  char inputChar;
-  int inputIndex = 0;
-  inputEnds[0] = 0;
-  //inputBuffer[0] = '\0';
+  ConsoleBase* ConsoleBase::first = NULL;
 
-  bool finished = false;
-  bool exit = false;
 
-  int timeoutCounter = 0;
-  
-  //SERIAL_INTERFACE.println(historyIndex);
+  // the type of consoleOutput, which prints to the console running the current command (the default console the rest of the time)
+  class ConsoleOutput : public Print {
+  public:
+    ConsoleBase* console = NULL; // console output is going to
+    Print* redirect = NULL; // if set, output goes here instead (used to capture what a command prints)
 
-  // get any serial input into a local string where we can search it without clearing it
-  while (inputEnds[historyIndex] < INPUT_BUFFER_SIZE-1 && !finished) {
-  
-    if (!SERIAL_INTERFACE.available()) {
-      
-      if (timeoutCounter < CONSOLE_CONTROL_TIMEOUT_MS) {
-        
-        timeoutCounter++; // note that a ms has passed without action
-        delay(1);
-        
-        continue; // keep looping until characters found
-      
-      } else {
+    #ifdef USE_CONSOLE_STATS
+    unsigned long bytesWritten = 0;
+    #endif
 
-        exit = true;
-        break;
-      }
+    using Print::write;
 
+    size_t write(uint8_t value) {
+      #ifdef USE_CONSOLE_STATS
+      bytesWritten++;
+      #endif
+      return redirect ? redirect->write(value) : target->write(value);
     }
 
-    timeoutCounter = 0; // clear timeout counter if data found
-
+    size_t write(const uint8_t* data, size_t size) {
+      #ifdef USE_CONSOLE_STATS
+      bytesWritten += size;
+      #endif
+      return redirect ? redirect->write(data,size) : target->write(data,size);
+    }
 
+    // sends everything the console has collected
+    void flush() {
+      if (!redirect) target->flush();
+    }
 
-    inputChar = SERIAL_INTERFACE.read();
-    
+    // makes output go to another console, returning the one it went to before
+    ConsoleBase* use(ConsoleBase* newConsole) {
+      ConsoleBase* previous = console;
+      console = newConsole;
+      target = &newConsole->writer();
+      return previous;
+    }
 
+  private:
+    Print* target = NULL;
+  };
 
 
-    switch (inputChar) {
-    case ESCAPE:
-      
-      delay(ESC_CODE_MS);
+  // sizes and characters of a console; a ConsoleControl<Stream,Config> can be given its own struct with the same members
+  // this one takes the definitions above, and is what the default console uses
+  struct ConsoleConfig {
+    static constexpr int inputBufferSize = INPUT_BUFFER_SIZE;
+    static constexpr int historyArenaSize = HISTORY_ARENA_SIZE; // bytes of command history
+    static constexpr int outputBufferSize = OUTPUT_BUFFER_SIZE;
+    static constexpr int rxBufferSize = CONSOLE_RX_BUFFER_SIZE;
+    static constexpr char delimiter = DELIMITER[0]; // parameter delimiter (usage strings still use DELIMITER)
+  };
 
-      // parse and remove any escape sequences before they enter buffer
-      if (SERIAL_INTERFACE.available()) {
 
-        catchEscapeSequence(historyIndex,inputIndex,allowHistory);
-        break;
-        
-      // if escape character entered alone, exit console input mode
-      } else {
+  #ifdef USE_BINARY_PROTOCOL
+  // counters for the binary protocol
+  struct BinaryStats {
+    unsigned long frames; // requests answered
+    unsigned long badFrames; // requests answered with BINARY_BAD_CRC
+    unsigned long droppedBytes; // bytes thrown away (outside a frame, in an oversized frame, or in one which timed out)
+  };
+  #endif
 
-        exit = true;
-        //SERIAL_INTERFACE.println();
-      }
 
-    case ENTER:
-      finished = true;
-    
-    case LINE_FEED:
+  #ifndef NO_EEPROM
+  // allows storing/reading from eeprom based on variable name
+  struct eepromVariable {
+    char* name;
+    uint8_t type; // 0 = byte; 1 = double
+    int address;
+    bool modified; // unused, use variableModified() instead (kept so initializers with it still compile)
+  };
+
+
+  // a variable's value, as it is stored in eeprom
+  union VariableValue {
+    uint8_t asByte;
+    double asDouble;
+    uint8_t bytes[sizeof(double)];
+  };
+
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  // tells how well the write-back cache is doing
+  struct WriteBackStats {
+    unsigned int pendingBytes; // bytes waiting to be committed
+    unsigned long puts; // values stored with @put (each would otherwise have been an eeprom write)
+    unsigned long eepromWrites; // eeprom writes made when committing (one per block with EEPROM_WRITE_BLOCK, otherwise one per byte)
+    unsigned long writesSaved; // eeprom writes avoided by combining and overwriting values, or by reverting them
+  };
+  #endif
+
+
+  #ifdef USE_EEPROM_LOG
+  // tells how the eeprom log is doing (write amplification is logBytes / valueBytes)
+  struct EepromLogStats {
+    unsigned long valueBytes; // bytes of values stored (what writing them in place would have written)
+    unsigned long logBytes; // bytes written to the log: values with their record headers and CRCs, segment headers, and compaction copies
+    unsigned long records; // records appended (not counting compaction copies)
+    unsigned long compactions; // segments compacted and freed
+    unsigned long copiedBytes; // bytes of values copied forward by compaction
+    unsigned int rebuildRecords; // records read by the last rebuild of the index
+    unsigned long rebuildMicros; // how long that took
+  };
+  #endif
+  #endif
+
+
+  // -- console control variables --/
+
+  Command commands[MAX_COMMANDS]; // list to hold commands
+  
+  int commandNum = 0; // command counter
+
+  #ifndef NO_TAB_COMPLETION
+  uint8_t commandsByName[MAX_COMMANDS]; // registered command indexes in strcmp() order of their names (the command table is in order already)
+  #endif
+
+  ConsoleOutput consoleOutput; // commands print through here, so their output goes to the console which ran them
+
+  #ifdef USE_CONSOLE_JOBS
+  Job jobs[MAX_JOBS]; // running jobs (see Job)
+  #endif
+
+  const Command* commandTable = NULL; // compile-time command table (in flash), sorted by name
+  int commandTableNum = 0; // how many commands are in the command table
+
+  #ifdef USE_CONSOLE_STATS
+  CommandStats commandStats[CONSOLE_STATS_COMMANDS]; // registered commands first, then command table commands (see findCommandStats())
+  ConsoleStats consoleStats = {0,0,0,0,{0,0},0};
+  #endif
+
+
+
+  #ifndef NO_EEPROM
+  eepromVariable variables[MAX_VARIABLES]; // place to declare eeprom variables
+
+  int variableNum = 0; // how many variables have been registered
+  int nextAddress = 0; // if using automatic variable address assignment, the next available address
+
+
+
+  static const char* typeNames[] = {"byte","double"}; //names of each variable type
+  static const uint8_t typeSizes[] = {sizeof(uint8_t),sizeof(double)}; // sizes of variable types
+  static const int typeNum = sizeof(typeNames)/sizeof(char*); // how many types there are
+
+
+  VariableValue variableValues[MAX_VARIABLES]; // RAM copy of each variable, read from eeprom on first use (or by loadVariables())
+  uint8_t loadedVariables[(MAX_VARIABLES+7)/8]; // one bit per variable, set once its RAM copy is valid
+  VariableValue missingVariable; // what accessors for unknown variables read (always 0)
+
+  // registry indexes, kept sorted as variables are registered (MAX_VARIABLES can be at most 255)
+  uint8_t variablesByName[MAX_VARIABLES]; // variable indexes in strcmp() order of their names
+  uint8_t variablesByAddress[MAX_VARIABLES]; // variable indexes in order of their addresses
+
+  uint8_t changedVariables[(MAX_VARIABLES+7)/8]; // one bit per variable, set when its value changes (cleared by the application)
+  void (*variableCallbacks[MAX_VARIABLES])(int variableIndex); // called when a variable's value changes (see onVariableChange())
+
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  uint8_t pendingVariables[(MAX_VARIABLES+7)/8]; // one bit per variable, set if it has a pending value
+  unsigned long pendingSinceMs = 0; // millis() when the oldest pending value was stored
+  int pendingPuts = 0; // values stored since the last commit or revert
+  WriteBackStats writeBackStats = {0,0,0,0}; // (pending values are held in variableValues)
+  #endif
+
+  #ifdef USE_VARIABLE_IMAGE
+  uint8_t imageBuffer[MAX_VARIABLES*sizeof(double)+4]; // image being received by @load (see "Variable images")
+  int imageLength = 0; // bytes of it received so far
+  #endif
+
+  #ifdef USE_EEPROM_LOG
+  int variableLocations[MAX_VARIABLES]; // eeprom address of each variable's latest value in the log (0 if it has none), see rebuildEepromLog()
+  bool logReady = false; // whether the log has been scanned since startup (and since the last variable was registered)
+  uint16_t logSequence = 0; // sequence number of the head segment (each segment opened gets the next one)
+  uint8_t logTail = 0; // oldest segment in use
+  uint8_t logHead = 0; // segment being appended to
+  int logOffset = 0; // where the next record goes in the head segment (0 if no segment is in use)
+  int compactOffset = 0; // next record to compact in the tail segment
+  EepromLogStats eepromLogStats = {0,0,0,0,0,0,0};
+  #endif
+
+  #endif
+
+
+  #ifdef USE_BINARY_PROTOCOL
+  bool binaryExit = false; // set by BINARY_EXIT, ends the session once the response is sent
+  BinaryStats binaryStats = {0,0,0}; // (for all consoles)
+  #endif
+
+
+
+  // -- consoles --/
+
+  // a console on one stream, with its own input, history, output and session state, in buffers sized by Config (see ConsoleConfig)
+  // all consoles share the registered commands and variables
+  // the default console (on SERIAL_INTERFACE) is run by consolePoll(); more can be made and polled in loop():
+  // ConsoleControl<HardwareSerial> maintenanceConsole(Serial2); ... maintenanceConsole.poll();
+  template <typename StreamType, typename Config = ConsoleConfig>
+  class ConsoleControl final : public ConsoleBase { // (final, so its own calls to receive() and writer() aren't virtual)
+  public:
+    ConsoleControl(StreamType &stream) : stream(stream), output(stream) {
+      static_assert(Config::inputBufferSize <= 255, "The input buffer can be at most 255 bytes (parameter lengths are stored in a byte)");
+      delimiter = Config::delimiter;
+      if (!consoleOutput.console) consoleOutput.use(this);
+    }
+
+    bool poll();
+    void run();
+    bool idle();
+    void receive();
+    Print &writer() { return output; }
+    #ifdef USE_BINARY_PROTOCOL
+    void startBinary();
+    #endif
+
+
+    StreamType &stream;
+    ConsoleWriter<StreamType,Config::outputBufferSize> output; // echo and prompts (command output goes through consoleOutput)
+
+    // previous commands, stored one after another as a length byte followed by the characters (wrapping around the end)
+    char historyArena[Config::historyArenaSize > 0 ? Config::historyArenaSize : 1];
+    int historyStart = 0; // position of the oldest stored command
+    int historyNewest = 0; // position of the newest stored command
+    int historyBytes = 0; // how many bytes of the arena are in use
+    int historyNum = 0; // how many commands are stored
+
+    char savedInput[Config::inputBufferSize]; // the command being entered before the history was recalled
+    int savedInputEnd = 0;
+
+    char inputBuffer[Config::inputBufferSize]; // the main input buffer
+    int inputEnd = 0; // how many characters have actually been entered
+
+    uint8_t rxBuffer[Config::rxBufferSize]; // input received from the stream but not handled yet (wraps around the end)
+    int rxStart = 0; // position of the oldest byte
+    int rxCount = 0; // how many bytes are waiting
+    RxStats rxStats = {0,0,0};
+    unsigned long reportedOverflows = 0; // rxStats.overflows when the user was last told about lost input
+
+
+    // -- console state (advanced by poll()) --/
+
+    bool consoleActive = false; // whether a console session is running (prompt shown, input being entered)
+    bool lineReady = false; // whether a finished line is waiting to be run
+    char* remainingCommands = NULL; // commands of the line still to run once the listing ends (see runCommandLine())
+    int consoleHistoryIndex = 0; // history entry being edited (0 = new command)
+    int consoleInputIndex = 0; // cursor position in the input buffer
+    unsigned long lastInputMs = 0; // millis() when the last character arrived
+
+    EscapeState escapeState = ESC_STATE_NONE; // progress through an incoming escape sequence
+    int escapeParameters[2]; // numbers in the control sequence being received ("escape [1;5C" -> 1,5)
+    int escapeParameterIndex = 0; // which number is being received
+    int escapeLength = 0; // how many characters of the control sequence have been received
+    unsigned long escapeMs = 0; // millis() when the last escape sequence character arrived
+
+    #ifndef NO_TAB_COMPLETION
+    bool tabPressed = false; // whether the last character was a tab (a second one lists the possible names)
+    #endif
+
+    #ifdef USE_BINARY_PROTOCOL
+    bool binaryMode = false; // whether the session is using the binary protocol instead of the terminal
+    uint8_t binaryFrame[BINARY_FRAME_SIZE+4]; // frame being received: start byte, length, payload, 2 byte CRC
+    int binaryLength = 0; // bytes of the frame received so far
+    unsigned long binaryByteMs = 0; // millis() when the last frame byte arrived
+    #endif
+
+
+  private:
+    int rxAvailable();
+    int rxPeek();
+    int rxRead();
+    bool rxTakeCancel();
+
+    int historyPosition(int position, int offset);
+    void dropOldestHistory();
+    void pushHistory(const char* line, int length);
+    char historyCharacter(int position, int offset);
+    void loadHistory(int historyIndex);
+
+    void printInputBuffer(int &inputIndex);
+    void printCode(int count, char code);
+    void moveCursor(int position);
+    void redrawLine(int start, int oldEnd, int newEnd);
+    void removeCharacter();
+    int findWordEdge(bool forward);
+    void runEscapeSequence(char finalChar, int parameter1, int parameter2);
+    bool readEscapeCharacter(char inputChar);
+    void editLine(char inputChar);
+    #ifndef NO_TAB_COMPLETION
+    void completeName(bool list);
+    #endif
+
+    void runCommandLine(char* text);
+    void continueListing();
+    void startNewLine();
+    void endConsoleSession();
+    bool advanceConsole();
+    #ifdef USE_BINARY_PROTOCOL
+    bool advanceBinary();
+    #endif
+  };
+
+
+  ConsoleControl<decltype(SERIAL_INTERFACE)> defaultConsole(SERIAL_INTERFACE); // the console on SERIAL_INTERFACE, run by consolePoll() and runSerialCommands()
+
+
+  // -- static RAM used by the main buffers (see CONSOLE_RAM_REPORT and CONSOLE_RAM_BUDGET) --/
+
+  constexpr unsigned int consoleRamCommands = sizeof(commands)
+    #ifndef NO_TAB_COMPLETION
+    + sizeof(commandsByName)
+    #endif
+    #ifdef USE_CONSOLE_STATS
+    + sizeof(commandStats) + sizeof(consoleStats)
+    #endif
+    #ifdef USE_CONSOLE_JOBS
+    + sizeof(jobs)
+    #endif
+    ;
+  constexpr unsigned int consoleRamConsole = sizeof(defaultConsole); // input, history, receive and output buffers (and binary frame)
+
+  #ifndef NO_EEPROM
+  constexpr unsigned int consoleRamVariables = sizeof(variables) + sizeof(variableValues) + sizeof(loadedVariables) + sizeof(variablesByName)
+    + sizeof(variablesByAddress) + sizeof(changedVariables) + sizeof(variableCallbacks)
+    #ifdef USE_EEPROM_WRITE_BACK
+    + sizeof(pendingVariables)
+    #endif
+    #ifdef USE_VARIABLE_IMAGE
+    + sizeof(imageBuffer)
+    #endif
+    #ifdef USE_EEPROM_LOG
+    + sizeof(variableLocations)
+    #endif
+    ;
+  #else
+  constexpr unsigned int consoleRamVariables = 0;
+  #endif
+
+  constexpr unsigned int consoleRamTotal = consoleRamCommands + consoleRamConsole + consoleRamVariables;
+//
+
+
+
+
+
+
+
+
+/* -- -- -- -- -- -- Functions -- -- -- -- -- -- */
+
+
+
+
+// registers a new command which can then be run via serial
+// takes a Command object which stores all the necessary data
+// the object can be represented by an initializer list
+int compareFlashNames(const char* name1, bool inFlash1, const char* name2, bool inFlash2);
+int findTableCommand(const char* name, bool inFlash);
+void reportTableCommand(const Command &command);
+
+void registerCommand(Command command) {
+  static_assert(MAX_COMMANDS <= 255, "MAX_COMMANDS can be at most 255");
+
+  if (findTableCommand(command.name,command.flashStrings) >= 0) {
+    reportTableCommand(command);
+    return;
+  }
+
+  if (commandNum < MAX_COMMANDS) {
+
+    #ifndef NO_TAB_COMPLETION
+    // find where the command goes in the name index
+    int namePosition = commandNum;
+    for (; namePosition > 0 && compareFlashNames(command.name,command.flashStrings,commands[commandsByName[namePosition-1]].name,commands[commandsByName[namePosition-1]].flashStrings) < 0; namePosition--);
+
+    memmove(&commandsByName[namePosition+1],&commandsByName[namePosition],commandNum-namePosition);
+    commandsByName[namePosition] = commandNum;
+    #endif
+
+    commands[commandNum] = command;
+    commandNum++;
+  } else {
+    SERIAL_INTERFACE.println(F("Out of space for commands. Change MAX_COMMANDS or register less commands."));
+  }
+}
+
+
+// registers a command with its strings in flash: registerCommand(F("@name"),F("description"),F("use"),max,min,&functionName)
+void registerCommand(const __FlashStringHelper* name, const __FlashStringHelper* description, const __FlashStringHelper* use,
+    uint8_t maxParameters, uint8_t minParameters, void (*function)(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH])) {
+  registerCommand({(const char*)name,(const char*)description,(const char*)use,maxParameters,minParameters,function,NULL,true});
+}
+
+void registerCommand(const __FlashStringHelper* name, const __FlashStringHelper* description, const __FlashStringHelper* use,
+    uint8_t maxParameters, uint8_t minParameters, void (*argsFunction)(CommandArgs &args)) {
+  registerCommand({(const char*)name,(const char*)description,(const char*)use,maxParameters,minParameters,NULL,argsFunction,true});
+}
+
+
+#ifndef NO_PARAMETER_SPECS
+// registers a command whose parameters are checked and converted before it runs, one spec per parameter:
+// const ParameterSpec speedParameters[] = {INT_PARAMETER(0,100),CHOICE_PARAMETER("fwd|rev")};
+// registerCommand({"@speed","sets the motor speed","@speed,[<0-100>],(fwd/rev)",0,1,NULL,&setSpeed},speedParameters);
+// maxParameters is set to the number of specs
+template <size_t N>
+void registerCommand(Command command, const ParameterSpec (&parameterSpecs)[N]) {
+  static_assert(N <= MAX_PARAMETERS, "More parameter specs than MAX_PARAMETERS.");
+
+  command.maxParameters = N;
+  command.parameterSpecs = parameterSpecs;
+  registerCommand(command);
+}
+
+
+// the same with the strings (and the specs, which must be PROGMEM) in flash
+template <size_t N>
+void registerCommand(const __FlashStringHelper* name, const __FlashStringHelper* description, const __FlashStringHelper* use,
+    uint8_t minParameters, void (*argsFunction)(CommandArgs &args), const ParameterSpec (&parameterSpecs)[N]) {
+  registerCommand({(const char*)name,(const char*)description,(const char*)use,0,minParameters,NULL,argsFunction,true},parameterSpecs);
+}
+#endif
+
+
+#ifdef USE_CONSOLE_JOBS
+// registers a command which runs as a job (see Job): registerJob(F("@name"),F("description"),F("use"),max,min,&stepFunction)
+void registerJob(const __FlashStringHelper* name, const __FlashStringHelper* description, const __FlashStringHelper* use,
+    uint8_t maxParameters, uint8_t minParameters, JobStatus (*jobFunction)(Job &job)) {
+  Command command = {(const char*)name,(const char*)description,(const char*)use,maxParameters,minParameters,NULL,NULL,true};
+  command.jobFunction = jobFunction;
+  registerCommand(command);
+}
+
+
+#ifndef NO_PARAMETER_SPECS
+// the same with parameter specs (PROGMEM); the job finds the converted parameters in job.args.parsed
+template <size_t N>
+void registerJob(const __FlashStringHelper* name, const __FlashStringHelper* description, const __FlashStringHelper* use,
+    uint8_t minParameters, JobStatus (*jobFunction)(Job &job), const ParameterSpec (&parameterSpecs)[N]) {
+  Command command = {(const char*)name,(const char*)description,(const char*)use,0,minParameters,NULL,NULL,true};
+  command.jobFunction = jobFunction;
+  registerCommand(command,parameterSpecs);
+}
+#endif
+#endif
+
+
+// compares text with a command name, which may be in flash (same result sign as strcmp)
+int compareCommandName(const char* text, const char* name, bool inFlash) {
+  return inFlash ? strcmp_P(text,name) : strcmp(text,name);
+}
+
+
+// returns a character of a name which may be in flash
+char nameCharacter(const char* name, bool inFlash, int position) {
+  return inFlash ? pgm_read_byte(name+position) : name[position];
+}
+
+
+// compares two names, either of which may be in flash (same result sign as strcmp)
+int compareFlashNames(const char* name1, bool inFlash1, const char* name2, bool inFlash2) {
+  for (int i = 0;; i++) {
+    uint8_t c1 = nameCharacter(name1,inFlash1,i);
+    uint8_t c2 = nameCharacter(name2,inFlash2,i);
+    if (c1 != c2 || c1 == '\0') return c1 - c2;
+  }
+}
+
+
+#ifndef NO_PARAMETER_SPECS
+// returns a copy of a command's parameter spec (the specs are in flash along with the strings, if they are)
+ParameterSpec readParameterSpec(const Command &command, int parameterIndex) {
+  ParameterSpec spec;
+
+  if (command.flashStrings) memcpy_P(&spec,&command.parameterSpecs[parameterIndex],sizeof(ParameterSpec));
+  else spec = command.parameterSpecs[parameterIndex];
+
+  return spec;
+}
+
+
+// returns a character of a word in a list of choices ('\0' at the '|' ending it)
+char choiceCharacter(const char* word, bool inFlash, int position) {
+  char c = nameCharacter(word,inFlash,position);
+  return c == '|' ? '\0' : c;
+}
+#endif
+
+
+// prints one of a command's strings, reading it from flash if that's where it is
+void printCommandString(Print &output, const char* string, bool inFlash) {
+  if (inFlash) output.print((const __FlashStringHelper*)string);
+  else output.print(string);
+}
+
+
+// declares a compile-time command table, to be followed by an initializer list of commands sorted by name
+// the table is constant, so it stays in flash
+#define COMMAND_TABLE(tableName) constexpr Command tableName[] PROGMEM
+
+
+// compares two strings at compile time (same result sign as strcmp)
+constexpr int compareNames(const char* a, const char* b) {
+  return (*a != *b || *a == '\0') ? (int)(uint8_t)*a - (int)(uint8_t)*b : compareNames(a+1,b+1);
+}
+
+
+// checks at compile time whether a command table is in order of its names (strictly, so no name is used twice)
+template <size_t N>
+constexpr bool isSortedByName(const Command (&table)[N], size_t i = 1) {
+  return i >= N || (compareNames(table[i-1].name,table[i].name) < 0 && isSortedByName(table,i+1));
+}
+
+
+// finds a command in the command table by name (binary searched), the name may be in flash
+// returns its index in the table, or -1 if it isn't there
+int findTableCommand(const char* name, bool inFlash) {
+  int low = 0;
+  int high = commandTableNum - 1;
+
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    const char* tableName = (const char*)pgm_read_ptr(&commandTable[middle].name);
+    bool tableInFlash = pgm_read_byte(&commandTable[middle].flashStrings);
+    int comparison = inFlash ? compareFlashNames(name,true,tableName,tableInFlash) : compareCommandName(name,tableName,tableInFlash);
+
+    if (comparison == 0) return middle;
+    else if (comparison < 0) high = middle - 1;
+    else low = middle + 1;
+  }
+
+  return -1;
+}
+
+
+// tells the user a registered command is hidden by the command table command with its name
+void reportTableCommand(const Command &command) {
+  SERIAL_INTERFACE.print(F("Command '"));
+  printCommandString(SERIAL_INTERFACE,command.name,command.flashStrings);
+  SERIAL_INTERFACE.println(F("' is already in the command table."));
+}
+
+
+// makes the commands in a compile-time command table available (see COMMAND_TABLE)
+// only one table can be used; commands added with registerCommand() are searched after the table
+// (so a registered command with the name of a table command would never run, which is reported)
+void useCommandTable(const Command* table, int tableNum) {
+  commandTable = table;
+  commandTableNum = tableNum;
+
+  for (int commandIndex = 0; commandIndex < commandNum; commandIndex++) {
+    if (findTableCommand(commands[commandIndex].name,commands[commandIndex].flashStrings) >= 0) reportTableCommand(commands[commandIndex]);
+  }
+}
+
+
+// registers a compile-time command table after checking it while compiling
+#define registerCommandTable(table) do { \
+    static_assert(sizeof(table)/sizeof(Command) <= MAX_TABLE_COMMANDS, "Too many commands in " #table ". Change MAX_TABLE_COMMANDS or use less commands."); \
+    static_assert(isSortedByName(table), "The commands in " #table " must be in order of their names (strcmp order), and each name used once."); \
+    useCommandTable(table,sizeof(table)/sizeof(Command)); \
+  } while (0)
+
+
+// how many commands are available (command table and registered commands)
+int commandCount() {
+  return commandTableNum + commandNum;
+}
+
+
+// returns a copy of the command at the given index (command table first, then registered commands)
+Command getCommand(int commandIndex) {
+  if (commandIndex >= commandTableNum) return commands[commandIndex - commandTableNum];
+
+  Command command;
+  memcpy_P(&command,&commandTable[commandIndex],sizeof(Command));
+  return command;
+}
+
+
+#ifndef NO_EEPROM
+// registers a new variable for use with EEPROM
+// takes a eepromVariable object which stores all the necessary data
+// the address field will be ignored (it is set by this function)
+// the object can be represented by an initializer list
+void registerVariable(eepromVariable variable) {
+  static_assert(MAX_VARIABLES <= 255, "MAX_VARIABLES can be at most 255");
+  
+  if (variableNum < MAX_VARIABLES) {
+
+    // find where the variable goes in the name index
+    int namePosition = variableNum;
+    for (; namePosition > 0 && strcmp(variable.name,variables[variablesByName[namePosition-1]].name) <= 0; namePosition--);
+
+    if (namePosition < variableNum && strcmp(variable.name,variables[variablesByName[namePosition]].name) == 0) {
+      SERIAL_INTERFACE.print(F("Variable '"));
+      SERIAL_INTERFACE.print(variable.name);
+      SERIAL_INTERFACE.println(F("' is already registered."));
+      return;
+    }
+
+    #ifdef USE_DYNAMIC_VAR_ADDRESSES
+    variable.address = nextAddress;
+    nextAddress += typeSizes[variable.type];
+    #endif
+
+    // and in the address index
+    int addressPosition = variableNum;
+    for (; addressPosition > 0 && variable.address < variables[variablesByAddress[addressPosition-1]].address; addressPosition--);
+
+
+    memmove(&variablesByName[namePosition+1],&variablesByName[namePosition],variableNum-namePosition);
+    variablesByName[namePosition] = variableNum;
+
+    memmove(&variablesByAddress[addressPosition+1],&variablesByAddress[addressPosition],variableNum-addressPosition);
+    variablesByAddress[addressPosition] = variableNum;
+
+    variables[variableNum] = variable;
+    variableNum++;
+
+    #ifdef USE_EEPROM_LOG
+    logReady = false; // the log's index only covers the variables registered when it was built
+    #endif
+
+  } else {
+
+    SERIAL_INTERFACE.println(F("Out of space for variables. Change MAX_VARIABLES or register less variables."));
+  }
+}
+#endif
+
+
+#ifndef NO_EEPROM
+void getVariable(CommandArgs &args);
+void putVariable(CommandArgs &args);
+void printVariables(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+#endif
+#ifdef USE_EEPROM_WRITE_BACK
+void commitVariables();
+void commitCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+void revertCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+#endif
+#ifdef USE_VARIABLE_IMAGE
+void dumpCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+void loadCommand(CommandArgs &args);
+#endif
+#ifdef USE_CONSOLE_ALIASES
+bool runAlias(const char* name, char delimiter);
+void aliasCommand(CommandArgs &args);
+#endif
+#ifdef USE_EEPROM_LOG
+bool stepEepromLog();
+void logCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+#endif
+#ifdef USE_BINARY_PROTOCOL
+bool advanceBinary();
+void binaryCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+#endif
+void printCommandHelp(CommandArgs &args);
+void printControls(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]);
+#ifdef USE_CONSOLE_STATS
+void statsCommand(CommandArgs &args);
+#endif
+#ifdef USE_CONSOLE_JOBS
+void jobsCommand(CommandArgs &args);
+#endif
+// format: void functionName(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]); or void functionName(CommandArgs &args);
+
+
+// initialize the default commands (allows selective inclusion of default commands using macros)
+void registerDefaultCommands() {
+  #ifndef NO_EEPROM
+  registerCommand({(const char*)F("@get"),(const char*)F("reads a variable from EEPROM"),(const char*)F("@get"DELIMITER"[<variable>]"),1,1,NULL,&getVariable,true,NULL,1});
+  registerCommand({(const char*)F("@put"),(const char*)F("stores a variable in EEPROM"),(const char*)F("@put"DELIMITER"[<variable>]"DELIMITER"[<value>]"),2,2,NULL,&putVariable,true,NULL,1});
+  registerCommand(F("@variables"),F("prints all eeprom variables and their types"),F("@variables"),0,0,&printVariables);
+  #endif
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  registerCommand(F("@commit"),F("writes values stored with @put to EEPROM"),F("@commit"),0,0,&commitCommand);
+  registerCommand(F("@revert"),F("discards values stored with @put since the last @commit"),F("@revert"),0,0,&revertCommand);
+  #endif
+
+  #ifdef USE_VARIABLE_IMAGE
+  registerCommand(F("@dump"),F("prints all variables as @load commands, which restore them when entered (on this or another device)"),F("@dump"),0,0,&dumpCommand);
+  #ifndef NO_PARAMETER_SPECS
+  static const ParameterSpec loadParameters[] PROGMEM = {INT_PARAMETER(0,sizeof(imageBuffer)-1),STRING_PARAMETER};
+  registerCommand(F("@load"),F("takes in a variable image printed by @dump, storing it once it is complete"),F("@load"DELIMITER"[<offset>]"DELIMITER"[<hex>]"),2,&loadCommand,loadParameters);
+  #else
+  registerCommand(F("@load"),F("takes in a variable image printed by @dump, storing it once it is complete"),F("@load"DELIMITER"[<offset>]"DELIMITER"[<hex>]"),2,2,&loadCommand);
+  #endif
+  #endif
+
+  #ifdef USE_CONSOLE_ALIASES
+  registerCommand(F("@alias"),F("lists aliases, adds a line of commands to one (making it if it's new), or deletes one; entering an alias's name runs its commands"),F("@alias"DELIMITER"(<name>)"DELIMITER"(<commands>/delete)"),MAX_PARAMETERS,0,&aliasCommand);
+  #endif
+
+  #ifdef USE_EEPROM_LOG
+  registerCommand(F("@log"),F("prints the state of the EEPROM log"),F("@log"),0,0,&logCommand);
+  #endif
+
+  #ifdef USE_BINARY_PROTOCOL
+  registerCommand(F("@binary"),F("switches the console to the binary protocol (for scripts)"),F("@binary"),0,0,&binaryCommand);
+  #endif
+
+  registerCommand(F("@help"),F("prints available commands or specific command data"),F("@help"DELIMITER"(<command>)"),1,0,&printCommandHelp);
+  registerCommand(F("@controls"),F("Prints available console controls"),F("@controls"),0,0,&printControls);
+
+  #ifdef USE_CONSOLE_JOBS
+  #ifndef NO_PARAMETER_SPECS
+  static constexpr char jobsChoices[] PROGMEM = "cancel|bg";
+  static const ParameterSpec jobsParameters[] PROGMEM = {INT_PARAMETER(1,MAX_JOBS),CHOICE_PARAMETER(jobsChoices)};
+  registerCommand(F("@jobs"),F("lists running jobs (or one of them), or cancels one or moves it to the background"),F("@jobs"DELIMITER"(<job>)"DELIMITER"(cancel/bg)"),0,&jobsCommand,jobsParameters);
+  #else
+  registerCommand(F("@jobs"),F("lists running jobs (or one of them), or cancels one or moves it to the background"),F("@jobs"DELIMITER"(<job>)"DELIMITER"(cancel/bg)"),2,0,&jobsCommand);
+  #endif
+  #endif
+
+  #ifdef USE_CONSOLE_STATS
+  #ifndef NO_PARAMETER_SPECS
+  static constexpr char statsChoices[] PROGMEM = "reset";
+  static const ParameterSpec statsParameters[] PROGMEM = {CHOICE_PARAMETER(statsChoices)};
+  registerCommand(F("@stats"),F("prints how often commands ran, how long they took and what they printed"),F("@stats"DELIMITER"(reset)"),0,&statsCommand,statsParameters);
+  #else
+  registerCommand(F("@stats"),F("prints how often commands ran, how long they took and what they printed"),F("@stats"DELIMITER"(reset)"),1,0,&statsCommand);
+  #endif
+  #endif
+
+}
+
+
+// moves everything each console's stream has received into its receive buffer
+// runs on every consolePoll(), between the commands of a line and while waiting to send output
+// commands which take a long time should call it now and then, so input sent meanwhile isn't lost
+void consoleYield() {
+  for (ConsoleBase* console = ConsoleBase::first; console; console = console->next) console->receive();
+}
+
+
+// prints a listing one line at a time: printLine(output,line) is called for line 0, 1, 2... until it returns false
+// started by a command, the lines are printed over the following polls, only as fast as the serial interface takes them,
+// so a long listing doesn't block; the prompt, and the rest of the line's commands, wait until it ends (ctrl-c stops it)
+// anywhere else (in a job, or while output is being captured or another listing is printing) it is printed at once
+void startListing(bool (*printLine)(Print &output, int line)) {
+  ConsoleBase* console = consoleOutput.console;
+
+  if (consoleOutput.redirect || !console || !console->runningLine || console->listing.printLine) {
+    for (int line = 0; printLine(consoleOutput,line); line++) {}
+    return;
+  }
+
+  console->listing = {printLine,0,0,false};
+}
+
+
+// waits for the next interrupt in a low-power mode if CONSOLE_IDLE_SLEEP is set (on AVR and ARM), otherwise just yields
+// the UART receive interrupt and the millis() tick both wake it, so input and timeouts are handled as usual
+void consoleSleep() {
+  #if defined(CONSOLE_IDLE_SLEEP) && defined(__AVR__)
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+  #elif defined(CONSOLE_IDLE_SLEEP) && defined(__arm__)
+  __WFI();
+  #else
+  yield();
+  #endif
+}
+
+// called while a blocking session (runSerialCommands() or run()) has nothing to do until more input arrives
+// can be set to another function, for a deeper sleep mode or a board specific way of waiting
+void (*consoleIdleHook)() = consoleSleep;
+
+
+// moves everything the stream has received into the receive buffer (see consoleYield())
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::receive() {
+  while (stream.available()) {
+    uint8_t inputByte = stream.read();
+    rxStats.received++;
+
+    if (rxCount == Config::rxBufferSize) {
+      rxStats.overflows++;
+      continue;
+    }
+
+    rxBuffer[(rxStart + rxCount) % Config::rxBufferSize] = inputByte;
+    rxCount++;
+    rxStats.highWater = max(rxStats.highWater,rxCount);
+  }
+}
+
+
+#ifdef CONSOLE_RECEIVE_IN_YIELD
+void yield() {
+  consoleYield();
+}
+#endif
+
+
+// how many received bytes are waiting to be handled
+template <typename StreamType, typename Config>
+int ConsoleControl<StreamType,Config>::rxAvailable() {
+  return rxCount;
+}
+
+
+// the next received byte, without taking it (-1 if there is none)
+template <typename StreamType, typename Config>
+int ConsoleControl<StreamType,Config>::rxPeek() {
+  return rxCount ? rxBuffer[rxStart] : -1;
+}
+
+
+// takes the next received byte (-1 if there is none)
+template <typename StreamType, typename Config>
+int ConsoleControl<StreamType,Config>::rxRead() {
+  if (rxCount == 0) return -1;
+
+  uint8_t inputByte = rxBuffer[rxStart];
+  rxStart = (rxStart + 1) % Config::rxBufferSize;
+  rxCount--;
+  return inputByte;
+}
+
+
+// looks for a CANCEL among the received bytes; if there is one, drops it and everything before it
+// returns whether there was one
+template <typename StreamType, typename Config>
+bool ConsoleControl<StreamType,Config>::rxTakeCancel() {
+  for (int i = rxCount - 1; i >= 0; i--) {
+    if (rxBuffer[(rxStart + i) % Config::rxBufferSize] != CANCEL) continue;
+
+    rxStart = (rxStart + i + 1) % Config::rxBufferSize;
+    rxCount -= i + 1;
+    return true;
+  }
+
+  return false;
+}
+
+
+// splits the input string into tokens in a single pass, ending each token in place (the input string is modified)
+// tokens are separated by one or more delimiters; a delimiter inside QUOTE characters does not split, and the quotes are removed
+// stores a pointer to and the length of each token, up to maxTokens tokens (anything after is ignored)
+// returns how many tokens were found
+int tokenize(char* input, char** tokens, uint8_t* lengths, int maxTokens, char delimiter = DELIMITER[0]) {
+
+  int tokenNum = 0;
+  char* read = input; // next character to look at
+  
+  while (tokenNum < maxTokens) {
+
+    while (*read == delimiter) read++; // skip to the start of the token
+
+    if (*read == '\0') break;
+
+    char* write = read; // end of the token so far (behind read once quotes have been removed)
+    bool quoted = false;
+    tokens[tokenNum] = write;
+
+    for (; *read != '\0' && (quoted || *read != delimiter); read++) {
+      if (*read == QUOTE) quoted = !quoted;
+      else *write++ = *read;
+    }
+
+    if (*read != '\0') read++; // step past the delimiter that ended the token
+    *write = '\0';
+
+    lengths[tokenNum] = write - tokens[tokenNum];
+    tokenNum++;
+  }
+
+  return tokenNum;
+}
+
+
+// finds the index of a command by name, without printing anything
+// the command table is binary searched, then registered commands are searched in order
+// returns commandCount() if there is no such command
+int findCommandIndex(const char* command) {
+  int tableIndex = findTableCommand(command,false);
+  if (tableIndex >= 0) return tableIndex;
+
+  int commandIndex = 0;
+  for(; commandIndex < commandNum && compareCommandName(command,commands[commandIndex].name,commands[commandIndex].flashStrings) != 0; commandIndex++);
+
+  return commandTableNum + commandIndex;
+}
+
+
+// tells the user a command doesn't exist
+void printUnknownCommand(const char* command) {
+  #ifdef USE_CONSOLE_STATS
+  consoleStats.unknownCommands++;
+  #endif
+
+  consoleOutput.print('\'');
+  consoleOutput.print(command);
+  consoleOutput.println(F("' is not a command. You can use the '@help' command to list all possible commands."));
+}
+
+
+// returns the index of the given command in the command list if it is valid, otherwise returns an index one past the end of the list
+int findAndCheckCommandIndex(const char* command) {
+  int commandIndex = findCommandIndex(command);
+  
+  if (commandIndex == commandCount()) printUnknownCommand(command);
+
+  return commandIndex;
+
+}
+
+
+#ifndef NO_EEPROM
+// returns the index of the given variable in the variable list if it is valid, otherwise returns an index one past the end of the list
+// returns variableNum if there is no such variable
+int findVariableIndex(const char* variable) {
+
+  // binary search of the name index
+  int low = 0;
+  int high = variableNum - 1;
+
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    int comparison = strcmp(variable,variables[variablesByName[middle]].name);
+
+    if (comparison == 0) return variablesByName[middle];
+
+    if (comparison < 0) high = middle - 1;
+    else low = middle + 1;
+  }
+
+  return variableNum;
+}
+
+
+// finds the variable stored at an address
+// returns variableNum if there is no such variable
+int findVariableAtAddress(int address) {
+
+  // binary search of the address index
+  int low = 0;
+  int high = variableNum - 1;
+
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    int middleAddress = variables[variablesByAddress[middle]].address;
+
+    if (middleAddress == address) return variablesByAddress[middle];
+
+    if (address < middleAddress) high = middle - 1;
+    else low = middle + 1;
+  }
+
+  return variableNum;
+}
+
+
+// same as findVariableIndex, but also prints an error if the variable doesn't exist
+int findAndCheckVariableIndex(const char* variable) {
+  int variableIndex = findVariableIndex(variable);
+  
+  if (variableIndex == variableNum) {
+    consoleOutput.print('\'');
+    consoleOutput.print(variable);
+    consoleOutput.println(F("' is not a variable. You can use the '@variables' command to list all variables."));
+  }
+
+  return variableIndex;
+
+}
+#endif
+
+
+
+#ifndef NO_TAB_COMPLETION
+// the lists of names which can be completed, each in strcmp() order
+enum NameList {
+  TABLE_COMMAND_NAMES,
+  REGISTERED_COMMAND_NAMES, // through commandsByName
+  VARIABLE_NAMES // through variablesByName
+};
+
+
+// how many names a list has
+int listedNameCount(int list) {
+  if (list == TABLE_COMMAND_NAMES) return commandTableNum;
+  if (list == REGISTERED_COMMAND_NAMES) return commandNum;
+  #ifndef NO_EEPROM
+  return variableNum;
+  #else
+  return 0;
+  #endif
+}
+
+
+// returns the name at a position of a list, and whether it is in flash
+const char* listedName(int list, int position, bool &inFlash) {
+  if (list == TABLE_COMMAND_NAMES) {
+    inFlash = pgm_read_byte(&commandTable[position].flashStrings);
+    return (const char*)pgm_read_ptr(&commandTable[position].name);
+  }
+
+  if (list == REGISTERED_COMMAND_NAMES) {
+    inFlash = commands[commandsByName[position]].flashStrings;
+    return commands[commandsByName[position]].name;
+  }
+
+  inFlash = false;
+  #ifndef NO_EEPROM
+  return variables[variablesByName[position]].name;
+  #else
+  return "";
+  #endif
+}
+
+
+// compares the start of a name with a prefix of the given length (same result sign as strncmp)
+int comparePrefix(const char* name, bool inFlash, const char* prefix, int length) {
+  for (int i = 0; i < length; i++) {
+    uint8_t c = nameCharacter(name,inFlash,i);
+    if (c != (uint8_t)prefix[i]) return c < (uint8_t)prefix[i] ? -1 : 1;
+  }
+
+  return 0;
+}
+
+
+// binary searches a list for the first name which starts with the prefix (or, if after is set, the first one past those)
+int findPrefixBound(int list, const char* prefix, int length, bool after) {
+  int low = 0;
+  int high = listedNameCount(list);
+
+  while (low < high) {
+    int middle = (low + high) / 2;
+    bool inFlash = false;
+    const char* name = listedName(list,middle,inFlash);
+    int comparison = comparePrefix(name,inFlash,prefix,length);
+
+    if (comparison < 0 || (after && comparison == 0)) low = middle + 1;
+    else high = middle;
+  }
+
+  return low;
+}
+
+
+// finds the command names (or variable names) which start with a prefix
+// the matches in each list are next to each other, so only the first and last of them need to be compared to find what they all share
+// returns how many there are; name is set to one of them and commonLength to how many characters they all start with
+int findCompletions(bool variableNames, const char* prefix, int length, const char* &name, bool &inFlash, int &commonLength) {
+  int count = 0;
+
+  int firstList = variableNames ? VARIABLE_NAMES : TABLE_COMMAND_NAMES;
+  int lastList = variableNames ? VARIABLE_NAMES : REGISTERED_COMMAND_NAMES;
+
+  for (int list = firstList; list <= lastList; list++) {
+    int first = findPrefixBound(list,prefix,length,false);
+    int end = findPrefixBound(list,prefix,length,true);
+    if (first == end) continue;
+
+    if (count == 0) {
+      name = listedName(list,first,inFlash);
+      commonLength = 0;
+      while (nameCharacter(name,inFlash,commonLength) != '\0') commonLength++;
+    }
+
+    int ends[2] = {first,end-1};
+    for (int i = 0; i < 2; i++) {
+      bool otherInFlash = false;
+      const char* other = listedName(list,ends[i],otherInFlash);
+
+      int shared = length;
+      while (shared < commonLength && nameCharacter(name,inFlash,shared) == nameCharacter(other,otherInFlash,shared)) shared++;
+      commonLength = shared;
+    }
+
+    count += end - first;
+  }
+
+  return count;
+}
+
+
+// prints the command names (or variable names) which start with a prefix
+void printCompletions(Print &output, bool variableNames, const char* prefix, int length) {
+  int firstList = variableNames ? VARIABLE_NAMES : TABLE_COMMAND_NAMES;
+  int lastList = variableNames ? VARIABLE_NAMES : REGISTERED_COMMAND_NAMES;
+
+  for (int list = firstList; list <= lastList; list++) {
+    int end = findPrefixBound(list,prefix,length,true);
+
+    for (int position = findPrefixBound(list,prefix,length,false); position < end; position++) {
+      bool inFlash = false;
+      printCommandString(output,listedName(list,position,inFlash),inFlash);
+      output.print(F("  "));
+    }
+  }
+}
+
+
+#ifndef NO_PARAMETER_SPECS
+// finds the words of a parameter's choices ("on|off|auto") which start with a prefix
+// returns how many there are; name is set to the first of them and commonLength to how many characters they all start with
+int findChoiceCompletions(const char* choices, bool inFlash, const char* prefix, int length, const char* &name, int &commonLength) {
+  int count = 0;
+
+  for (const char* word = choices;; word++) {
+    int i = 0;
+    for (; i < length && choiceCharacter(word,inFlash,i) == prefix[i] && prefix[i] != '\0'; i++);
+
+    if (i == length) {
+      if (count == 0) {
+        name = word;
+        commonLength = length;
+        while (choiceCharacter(word,inFlash,commonLength) != '\0') commonLength++;
+      }
+
+      int shared = length;
+      while (shared < commonLength && choiceCharacter(name,inFlash,shared) == choiceCharacter(word,inFlash,shared)) shared++;
+      commonLength = shared;
+      count++;
+    }
+
+    while (choiceCharacter(word,inFlash,0) != '\0') word++;
+    if (nameCharacter(word,inFlash,0) == '\0') return count;
+  }
+}
+
+
+// prints the words of a parameter's choices which start with a prefix
+void printChoiceCompletions(Print &output, const char* choices, bool inFlash, const char* prefix, int length) {
+  for (const char* word = choices;; word++) {
+    int i = 0;
+    for (; i < length && choiceCharacter(word,inFlash,i) == prefix[i]; i++);
+
+    for (; choiceCharacter(word,inFlash,0) != '\0'; word++) {
+      if (i == length) output.print(nameCharacter(word,inFlash,0));
+    }
+    if (i == length) output.print(F("  "));
+
+    if (nameCharacter(word,inFlash,0) == '\0') return;
+  }
+}
+#endif
+#endif
+
+
+
+// position in the history arena a given number of bytes after another position (wraps around the end)
+template <typename StreamType, typename Config>
+int ConsoleControl<StreamType,Config>::historyPosition(int position, int offset) {
+  return (position + offset) % sizeof(historyArena);
+}
+
+
+// removes the oldest command from the history
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::dropOldestHistory() {
+  historyBytes -= (uint8_t)historyArena[historyStart] + 1;
+  historyStart = historyPosition(historyStart,(uint8_t)historyArena[historyStart] + 1);
+  historyNum--;
+}
+
+
+// stores a command in the history, making room by removing the oldest commands
+// empty commands and commands too long for the arena are not stored
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::pushHistory(const char* line, int length) {
+
+  if (length == 0 || length > 255 || length + 1 > Config::historyArenaSize) return;
+
+  #ifdef HISTORY_SKIP_DUPLICATES
+  if (historyNum > 0 && (uint8_t)historyArena[historyNewest] == length) {
+    int i = 0;
+    for (; i < length && historyArena[historyPosition(historyNewest,i+1)] == line[i]; i++);
+    if (i == length) return;
+  }
+  #endif
+
+  while (historyBytes + length + 1 > Config::historyArenaSize) dropOldestHistory();
+
+  int position = historyPosition(historyStart,historyBytes);
+  historyNewest = position;
+
+  historyArena[position] = length;
+  for (int i = 0; i < length; i++) historyArena[historyPosition(position,i+1)] = line[i];
+
+  historyBytes += length + 1;
+  historyNum++;
+}
+
+
+// returns a character of a command in the history, found at position in the arena (-1 for the command saved when recalling the history started)
+template <typename StreamType, typename Config>
+char ConsoleControl<StreamType,Config>::historyCharacter(int position, int offset) {
+  return position < 0 ? savedInput[offset] : historyArena[historyPosition(position,offset+1)];
+}
+
+
+// copies a command from the history into the input buffer and onto the screen, leaving the cursor at the end
+// historyIndex 1 is the most recent command; 0 restores the command which was being entered before recalling the history
+// only the part which differs from the line on screen is redrawn (see redrawLine())
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::loadHistory(int historyIndex) {
+
+  int position = -1;
+  int length = savedInputEnd;
+
+  if (historyIndex > 0) {
+    // step forward from the oldest command
+    position = historyStart;
+    for (int i = historyNum; i > historyIndex; i--) position = historyPosition(position,(uint8_t)historyArena[position] + 1);
+
+    length = (uint8_t)historyArena[position];
+  }
+
+  // the same characters at the start and at the end of both lines don't need redrawing
+  int prefix = 0;
+  while (prefix < inputEnd && prefix < length && inputBuffer[prefix] == historyCharacter(position,prefix)) prefix++;
+
+  int suffix = 0;
+  while (suffix < inputEnd - prefix && suffix < length - prefix && inputBuffer[inputEnd-1-suffix] == historyCharacter(position,length-1-suffix)) suffix++;
+
+  for (int i = prefix; i < length; i++) inputBuffer[i] = historyCharacter(position,i);
+
+  int oldEnd = inputEnd;
+  inputEnd = length;
+
+  redrawLine(prefix,oldEnd - suffix,length - suffix);
+  moveCursor(inputEnd);
+}
+
+
+// prints the input buffer to the current line after clearing it, leaving the cursor at the end
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::printInputBuffer(int &inputIndex) {
+
+  output.echo(F("\u001b[2K\r"));
+  
+  output.echo(ENTRY_PREFIX);
+
+  for (int i = 0; i < inputEnd; i++) {
+    output.echo(inputBuffer[i]);
+  }
+
+  inputIndex = inputEnd;
+}
+
+
+
+// prints a control sequence which takes a count ("escape [ <count> <code>"), leaving out a count of 1
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::printCode(int count, char code) {
+  output.echo(F("\u001b["));
+
+  if (count > 1) { // (at most the input buffer size, so three digits)
+    if (count >= 100) output.echo((char)('0' + count / 100));
+    if (count >= 10) output.echo((char)('0' + count / 10 % 10));
+    output.echo((char)('0' + count % 10));
+  }
+
+  output.echo(code);
+}
+
+
+// moves the cursor to a position in the input buffer, echoing the movement
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::moveCursor(int position) {
+
+  int &inputIndex = consoleInputIndex;
+
+  if (position == inputIndex) return;
+
+  printCode(abs(position - inputIndex),position > inputIndex ? 'C' : 'D');
+
+  inputIndex = position;
+}
+
+
+// updates the screen after the input buffer was changed between start and newEnd
+// on screen, the characters from start to oldEnd are replaced by those, and the rest of the line moves along with them
+// only the changed span and the cursor moves are sent; the rest of the line is shifted by the terminal (insert/delete character codes)
+// leaves the cursor at newEnd
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::redrawLine(int start, int oldEnd, int newEnd) {
+
+  #ifdef USE_CONSOLE_STATS
+  unsigned long startBytes = output.bytesWritten();
+  #endif
+
+  int tail = inputEnd - newEnd; // characters after the change
+
+  #ifdef NO_INSERT_DELETE_CODES
+  // the rest of the line is redrawn instead of shifted
+  int cursor = newEnd;
+  oldEnd += tail;
+  newEnd = inputEnd;
+  tail = 0;
+  #endif
+
+  moveCursor(start);
+
+  for (int i = start; i < newEnd; i++) {
+    if (i == oldEnd && tail > 0) printCode(newEnd - oldEnd,'@'); // open a gap for the rest of the new span
+    output.echo(inputBuffer[i]);
+  }
+  consoleInputIndex = newEnd;
+
+  if (oldEnd > newEnd) {
+    if (tail > 0) printCode(oldEnd - newEnd,'P'); // close the gap
+    else if (oldEnd - newEnd == 1) output.echo(F(" \b"));
+    else output.echo(F("\u001b[K")); // clear to the end of the line
+  }
+
+  #ifdef NO_INSERT_DELETE_CODES
+  moveCursor(cursor);
+  #endif
+
+  #ifdef USE_CONSOLE_STATS
+  consoleStats.redraws++;
+  consoleStats.redrawBytes += output.bytesWritten() - startBytes;
+  #endif
+}
+
+
+// removes the character under the cursor, redrawing the rest of the line
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::removeCharacter() {
+
+  int &inputIndex = consoleInputIndex;
+
+  if (inputIndex == inputEnd) return;
+
+  for (int i = inputIndex+1; i < inputEnd; i++) inputBuffer[i-1] = inputBuffer[i];
+  inputEnd--;
+
+  redrawLine(inputIndex,inputIndex+1,inputIndex);
+}
+
+
+// whether a character separates words (for moving the cursor a word at a time)
+bool isWordSeparator(char c, char delimiter) {
+  return c == delimiter || c == ' ';
+}
+
+
+// finds the start of the word before the cursor, or the end of the word after it
+template <typename StreamType, typename Config>
+int ConsoleControl<StreamType,Config>::findWordEdge(bool forward) {
+
+  int position = consoleInputIndex;
+
+  if (forward) {
+    while (position < inputEnd && isWordSeparator(inputBuffer[position],Config::delimiter)) position++;
+    while (position < inputEnd && !isWordSeparator(inputBuffer[position],Config::delimiter)) position++;
+  } else {
+    while (position > 0 && isWordSeparator(inputBuffer[position-1],Config::delimiter)) position--;
+    while (position > 0 && !isWordSeparator(inputBuffer[position-1],Config::delimiter)) position--;
+  }
+
+  return position;
+}
+
+
+// implements a finished escape sequence, ignoring any which aren't used
+// finalChar is the character ending the sequence, and parameters are its numbers (0 if not given)
+// handles arrows (with ctrl/alt to move by words), home, end and delete in both the "escape [" and "escape O" forms
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::runEscapeSequence(char finalChar, int parameter1, int parameter2) {
+
+  int &historyIndex = consoleHistoryIndex;
+  int &inputIndex = consoleInputIndex;
+
+  bool byWord = parameter2 == 3 || parameter2 == 5; // "[1;5C" (ctrl) or "[1;3C" (alt)
+
+  if (finalChar == '~') { // "[<number>~" keys
+    if (parameter1 == 1 || parameter1 == 7) finalChar = 'H';
+    else if (parameter1 == 4 || parameter1 == 8) finalChar = 'F';
+    else if (parameter1 == 3) finalChar = 'P'; // (not a real final character, used for delete below)
+    else return;
+  }
+
+  switch (finalChar) {
+  case 'C': // right arrow
+    moveCursor(byWord ? findWordEdge(true) : min(inputIndex+1,inputEnd));
+    break;
+
+  case 'D': // left arrow
+    moveCursor(byWord ? findWordEdge(false) : max(inputIndex-1,0));
+    break;
+
+  case 'H': // home
+    moveCursor(0);
+    break;
+
+  case 'F': // end
+    moveCursor(inputEnd);
+    break;
+
+  case 'P': // delete
+    removeCharacter();
+    break;
+
+  case 'A': // up arrow, recall further back in history
+    if (historyIndex < historyNum) {
+      
+      if(historyIndex == 0) {
+        for (int i = 0; i < inputEnd; i++) savedInput[i] = inputBuffer[i];
+        savedInputEnd = inputEnd;
+      }
+ 
+      historyIndex++;
+      
+      loadHistory(historyIndex);
+    }
+    break;
+
+  case 'B': // down arrow, recall less far back in history
+    if (historyIndex > 0) {
+      
+      historyIndex--;
+
+      loadHistory(historyIndex);
+    }
+    break;
+  }
+}
+
+
+// takes in one character following an escape, one at a time as they arrive
+// "escape [" starts a control sequence: numbers separated by ';', then a final character from '@' to '~'
+// "escape O" is followed by just the final character
+// returns false if the character doesn't continue the sequence; the sequence is then dropped and the character should be handled as normal input
+template <typename StreamType, typename Config>
+bool ConsoleControl<StreamType,Config>::readEscapeCharacter(char inputChar) {
+
+  escapeMs = millis();
+
+  switch (escapeState) {
+  case ESC_STATE_STARTED:
+    
+    escapeLength = 0;
+    escapeParameters[0] = 0;
+    escapeParameters[1] = 0;
+    escapeParameterIndex = 0;
+
+    if (inputChar == '[') escapeState = ESC_STATE_CSI;
+    else if (inputChar == 'O') escapeState = ESC_STATE_SS3;
+    else {
+      escapeState = ESC_STATE_NONE;
+      return false;
+    }
+    return true;
+
+  case ESC_STATE_SS3:
+    escapeState = ESC_STATE_NONE;
+    if (inputChar < '@' || inputChar > '~') return false;
+
+    runEscapeSequence(inputChar,0,0);
+    return true;
+
+  case ESC_STATE_CSI:
+    if (inputChar < ' ' || inputChar > '~') { // a control character can't be part of the sequence
+      escapeState = ESC_STATE_NONE;
+      return false;
+    }
+
+    escapeLength++;
+
+    if (inputChar >= '@') { // final character
+      escapeState = ESC_STATE_NONE;
+      
+      // overly long sequences are consumed but not run
+      if (escapeLength <= MAX_ESC_CODE_LENGTH) runEscapeSequence(inputChar,escapeParameters[0],escapeParameters[1]);
+    
+    } else if (inputChar >= '0' && inputChar <= '9') {
+      int &parameter = escapeParameters[escapeParameterIndex];
+      if (parameter < 1000) parameter = parameter*10 + (inputChar - '0');
+    
+    } else if (inputChar == ';' && escapeParameterIndex < 1) {
+      escapeParameterIndex++;
+    }
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+
+// takes in one character typed by the user, updating the input buffer and the echo on the terminal
+// sets lineReady once the line is finished (enter pressed or the buffer is full)
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::editLine(char inputChar) {
+
+  int &inputIndex = consoleInputIndex;
+
+  #ifndef NO_TAB_COMPLETION
+  bool repeatedTab = tabPressed;
+  tabPressed = inputChar == TAB;
+  #endif
+
+  switch (inputChar) {
+  case ESCAPE:
+
+    // wait to see if an escape sequence follows, or if escape was pressed alone (exits console mode)
+    escapeState = ESC_STATE_STARTED;
+    escapeMs = millis();
+    break;
+
+  case ENTER:
+    lineReady = true;
+    break;
+  
+  case LINE_FEED:
+    break;
+
+  case CANCEL:
+    #ifdef USE_CONSOLE_JOBS
+    if (cancelForegroundJobs(this)) break;
+    #endif
+
+    // nothing to cancel but the line being entered
+    output.println(F("^C"));
+    startNewLine();
+    break;
+
+  #ifndef NO_TAB_COMPLETION
+  case TAB:
+    completeName(repeatedTab);
+    tabPressed = true; // (typing the completion cleared it)
+    break;
+  #endif
+  
+  case BACKSPACE: // backspace on linux
+
+  case DELETE: // backspace in putty
+
+    if (inputIndex > 0) {
+      output.echo('\b');
+      inputIndex--;
+
+      removeCharacter();
+    }
+    break;
+
+  default: // anything else
+    if (inputIndex == inputEnd) { // typing at the end of the line
+      output.echo(inputChar);
+      inputBuffer[inputEnd++] = inputChar;
+      inputIndex++;
+      break;
+    }
+
+    for (int i = inputEnd; i > inputIndex; i--) inputBuffer[i] = inputBuffer[i-1];
+    inputBuffer[inputIndex] = inputChar;
+    inputEnd++;
+
+    redrawLine(inputIndex,inputIndex,inputIndex+1);
+  }
+
+  // a full buffer ends the line
+  if (inputEnd >= Config::inputBufferSize-1) lineReady = true;
+}
+
+
+#ifndef NO_TAB_COMPLETION
+// completes the command name (or the variable name, for a command's variableParameter such as @get's) being entered at the end of the line
+// only the missing characters are typed; if several names match, as many as they all share
+// if there is nothing to add and list is set, the matching names are printed and the line is shown again
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::completeName(bool list) {
+
+  if (consoleInputIndex != inputEnd) return;
+
+  // find the start of the word and of the command it is part of
+  int start = inputEnd;
+  for (; start > 0 && inputBuffer[start-1] != Config::delimiter && inputBuffer[start-1] != COMMAND_SEPARATOR; start--);
+
+  int commandStart = start;
+  int parameter = 0;
+  for (; commandStart > 0 && inputBuffer[commandStart-1] != COMMAND_SEPARATOR; commandStart--) {
+    if (inputBuffer[commandStart-1] == Config::delimiter) parameter++;
+  }
+
+  while (commandStart < inputEnd && inputBuffer[commandStart] == ' ') commandStart++;
+  if (parameter == 0) start = commandStart;
+
+  bool variableNames = false; // whether the parameter is a variable name (see Command::variableParameter)
+  const char* choices = NULL; // the words the parameter can be, if its command has a parameter spec saying so
+  #ifndef NO_PARAMETER_SPECS
+  bool choicesInFlash = false;
+  #endif
+
+  if (parameter > 0) {
+    #if !defined(NO_EEPROM) || !defined(NO_PARAMETER_SPECS) // (otherwise only command names complete)
+    int commandLength = 0;
+    while (inputBuffer[commandStart+commandLength] != Config::delimiter) commandLength++;
+
+    char delimiter = inputBuffer[commandStart+commandLength];
+    inputBuffer[commandStart+commandLength] = '\0'; // (for a moment, to look the command up)
+    int commandIndex = findCommandIndex(inputBuffer+commandStart);
+    inputBuffer[commandStart+commandLength] = delimiter;
+
+    if (commandIndex < commandCount()) {
+      Command command = getCommand(commandIndex);
+
+      #ifndef NO_EEPROM
+      variableNames = parameter == command.variableParameter;
+      #endif
+
+      #ifndef NO_PARAMETER_SPECS
+      if (command.parameterSpecs && parameter <= command.maxParameters) {
+        ParameterSpec spec = readParameterSpec(command,parameter-1);
+        if (spec.type == PARAMETER_CHOICE) choices = spec.choices;
+        choicesInFlash = command.flashStrings;
+      }
+      #endif
+    }
+    #endif
+
+    if (!variableNames && !choices) return;
+  }
+
+
+  int length = inputEnd - start;
+  const char* name;
+  bool inFlash = false;
+  int commonLength;
+  int count;
+
+  #ifndef NO_PARAMETER_SPECS
+  if (choices) {
+    count = findChoiceCompletions(choices,choicesInFlash,inputBuffer+start,length,name,commonLength);
+    inFlash = choicesInFlash;
+  } else
+  #endif
+  count = findCompletions(variableNames,inputBuffer+start,length,name,inFlash,commonLength);
+
+  if (count == 0) return;
+
+  if (commonLength > length) {
+    for (int i = length; i < commonLength && !lineReady; i++) editLine(nameCharacter(name,inFlash,i));
+
+  } else if (list && count > 1) {
+    output.println();
+    #ifndef NO_PARAMETER_SPECS
+    if (choices) printChoiceCompletions(output,choices,choicesInFlash,inputBuffer+start,length);
+    else
+    #endif
+    printCompletions(output,variableNames,inputBuffer+start,length);
+    output.println();
+    printInputBuffer(consoleInputIndex);
+  }
+}
+#endif
+
+
+
+#ifdef USE_CONSOLE_STATS
+// returns the statistics kept for a command, or NULL if there is no room for them (see CONSOLE_STATS_COMMANDS)
+CommandStats* findCommandStats(int commandIndex) {
+  int slot = commandIndex >= commandTableNum ? commandIndex - commandTableNum : MAX_COMMANDS + commandIndex;
+  return slot < CONSOLE_STATS_COMMANDS ? &commandStats[slot] : NULL;
+}
+
+
+// adds a run of a command to its statistics
+void recordCommandRun(int commandIndex, unsigned long runMicros, unsigned long bytesWritten) {
+  CommandStats* stats = findCommandStats(commandIndex);
+  if (!stats) return;
+
+  if (stats->calls == 0 || runMicros < stats->minMicros) stats->minMicros = runMicros;
+  if (runMicros > stats->maxMicros) stats->maxMicros = runMicros;
+  stats->totalMicros += runMicros;
+  stats->bytesWritten += bytesWritten;
+  stats->calls++;
+}
+
+
+// counts a command given too few parameters
+void recordParseFailure(int commandIndex) {
+  CommandStats* stats = findCommandStats(commandIndex);
+  if (stats) stats->parseFailures++;
+}
+
+
+// clears all statistics
+void resetStats() {
+  memset(commandStats,0,sizeof(commandStats));
+  consoleStats = {0,0,0,0,{0,0},millis()};
+
+  for (ConsoleBase* console = ConsoleBase::first; console; console = console->next) {
+    console->activeTime = {0,0};
+    console->idleTime = {0,0};
+  }
+}
+#endif
+
+
+// prints how a command is used, after a mistake in its parameters
+void printCorrectFormat(const Command &command) {
+  consoleOutput.print(F("Correct format: "));
+  printCommandString(consoleOutput,command.use,command.flashStrings);
+  consoleOutput.println();
+}
+
+
+// checks that enough parameters were given for a command
+// returns true if there were enough parameters
+// otherwise prints the correct format and returns false
+bool checkParameters(CommandArgs &args, const Command &command) {
+
+  if (args.count < command.minParameters) {
+    consoleOutput.println(F("Too few parameters!"));
+    printCorrectFormat(command);
+    
+    return false;
+  }
+
+  return true;
+}
+
+
+
+#ifndef NO_PARAMETER_SPECS
+// finds which of the choices ("on|off|auto") some text is
+// returns its position in the list, or -1 if it isn't one of them
+int findChoice(const char* choices, bool inFlash, const char* text) {
+  int choice = 0;
+
+  for (const char* word = choices;; choice++) {
+    int i = 0;
+    for (; text[i] != '\0' && choiceCharacter(word,inFlash,i) == text[i]; i++);
+    if (text[i] == '\0' && choiceCharacter(word,inFlash,i) == '\0') return choice;
+
+    // next word
+    while (choiceCharacter(word,inFlash,0) != '\0') word++;
+    if (nameCharacter(word,inFlash,0) == '\0') return -1;
+    word++;
+  }
+}
+
+
+// checks a parameter against its spec and converts it
+// returns false if it doesn't fit
+bool parseParameter(const ParameterSpec &spec, bool inFlash, const char* text, ParameterValue &value) {
+  char* end;
+
+  switch (spec.type) {
+    case PARAMETER_INT:
+    case PARAMETER_BYTE: {
+      errno = 0;
+      long number = strtol(text,&end,10);
+      if (end == text || *end != '\0' || errno == ERANGE || (spec.ranged && (number < spec.min.asInt || number > spec.max.asInt))) return false;
+      if (spec.type == PARAMETER_BYTE && (number < 0 || number > 255)) return false;
+
+      if (spec.type == PARAMETER_BYTE) value.asByte = number;
+      else value.asInt = number;
+      return true;
+    }
+    case PARAMETER_DOUBLE: {
+      double number = strtod(text,&end);
+      if (end == text || *end != '\0' || isnan(number) || isinf(number) || (spec.ranged && (number < spec.min.asDouble || number > spec.max.asDouble))) return false;
+
+      value.asDouble = number;
+      return true;
+    }
+    case PARAMETER_CHOICE: {
+      int choice = findChoice(spec.choices,inFlash,text);
+      if (choice < 0) return false;
+
+      value.asChoice = choice;
+      return true;
+    }
+    default:
+      return true;
+  }
+}
+
+
+// checks a command's entered parameters against its parameter specs, and converts them into args.parsed
+// returns the index of the first parameter which doesn't fit its spec, or -1 if all of them do
+int parseParameters(CommandArgs &args, const Command &command) {
+
+  for (int i = 0; i < args.count; i++) {
+    if (!parseParameter(readParameterSpec(command,i),command.flashStrings,args.values[i],args.parsed[i])) return i;
+  }
+
+  return -1;
+}
+
+
+// tells the user what a parameter should have been, and the correct format
+void printParameterError(const Command &command, int parameterIndex, const char* text) {
+  ParameterSpec spec = readParameterSpec(command,parameterIndex);
+
+  consoleOutput.print(F("Parameter "));
+  consoleOutput.print(parameterIndex+1);
+  consoleOutput.print(F(" ('"));
+  consoleOutput.print(text);
+  consoleOutput.print(F("') must be "));
+
+  if (spec.type == PARAMETER_CHOICE) {
+    consoleOutput.print(F("one of: "));
+    printCommandString(consoleOutput,spec.choices,command.flashStrings);
+
+  } else {
+    consoleOutput.print(spec.type == PARAMETER_DOUBLE ? F("a number") : F("a whole number"));
+
+    if (spec.type == PARAMETER_BYTE && !spec.ranged) spec = BYTE_PARAMETER(0,255);
+
+    if (spec.ranged) {
+      consoleOutput.print(F(" from "));
+      if (spec.type == PARAMETER_DOUBLE) consoleOutput.print(spec.min.asDouble);
+      else consoleOutput.print(spec.min.asInt);
+      consoleOutput.print(F(" to "));
+      if (spec.type == PARAMETER_DOUBLE) consoleOutput.print(spec.max.asDouble);
+      else consoleOutput.print(spec.max.asInt);
+    }
+  }
+
+  consoleOutput.println();
+  printCorrectFormat(command);
+}
+#endif
+
+
+// copies parameters into the fixed size array taken by command functions which don't use CommandArgs
+// parameters which don't fit are cut short, missing parameters are left empty
+void copyParameters(CommandArgs &args, char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+
+  for (int parameterIndex = 0; parameterIndex < MAX_PARAMETERS; parameterIndex++) {
+    
+    int i = 0;
+    for (; i < MAX_PARAMETER_LENGTH-1 && args.values[parameterIndex][i] != '\0'; i++) {
+      parameters[parameterIndex][i] = args.values[parameterIndex][i];
+    }
+
+    parameters[parameterIndex][i] = '\0';
+  }
+}
+
+
+
+
+#ifdef USE_CONSOLE_JOBS
+// starts a job for a command (see Job), in the foreground of the console running the command
+// its parameters are copied, as they only last until the next line is entered
+void startJob(int commandIndex, CommandArgs &args) {
+
+  int slot = 0;
+  while (slot < MAX_JOBS && jobs[slot].running) slot++;
+
+  if (slot == MAX_JOBS) {
+    consoleOutput.println(F("Too many jobs running. Wait for one to finish, cancel one with @jobs, or change MAX_JOBS."));
+    return;
+  }
+
+  Job &job = jobs[slot];
+  int length = 0;
+
+  for (int i = 0; i < MAX_PARAMETERS; i++) {
+    if (i >= args.count) {
+      job.args.values[i] = (char*)"";
+      job.args.lengths[i] = 0;
+      continue;
+    }
+
+    if (length + args.lengths[i] + 1 > JOB_TEXT_SIZE) {
+      consoleOutput.println(F("The parameters are too long for a job. Change JOB_TEXT_SIZE."));
+      return;
+    }
+
+    memcpy(job.text+length,args.values[i],args.lengths[i]);
+    job.text[length+args.lengths[i]] = '\0';
+
+    job.args.values[i] = job.text+length;
+    job.args.lengths[i] = args.lengths[i];
+    #ifndef NO_PARAMETER_SPECS
+    job.args.parsed[i] = args.parsed[i];
+    #endif
+
+    length += args.lengths[i] + 1;
+  }
+  job.args.count = args.count;
+
+  memset(&job.state<uint8_t[JOB_STATE_SIZE]>(),0,JOB_STATE_SIZE);
+  job.running = true;
+  job.foreground = true;
+  job.cancelled = false;
+  job.commandIndex = commandIndex;
+  job.console = consoleOutput.console;
+  job.resumeLine = 0;
+  job.startMs = millis();
+  job.wakeMs = job.startMs;
+  job.steps = 0;
+  job.busyMicros = 0;
+}
+
+
+// prints a job's number and command name
+void printJobName(int slot) {
+  Command command = getCommand(jobs[slot].commandIndex);
+
+  consoleOutput.print(F("Job "));
+  consoleOutput.print(slot+1);
+  consoleOutput.print(F(" ("));
+  printCommandString(consoleOutput,command.name,command.flashStrings);
+  consoleOutput.print(F(")"));
+}
+
+
+// runs one step of each job started from a console whose time has come (called by the console's poll())
+void stepJobs(ConsoleBase* console) {
+  for (int slot = 0; slot < MAX_JOBS; slot++) {
+    Job &job = jobs[slot];
+
+    if (!job.running || job.console != console) continue;
+    if (!job.cancelled && (long)(millis() - job.wakeMs) < 0) continue; // sleeping
+
+    ConsoleBase* previousConsole = consoleOutput.use(console);
+    unsigned long startMicros = micros();
+
+    JobStatus status = getCommand(job.commandIndex).jobFunction(job);
+
+    job.busyMicros += micros() - startMicros;
+    job.steps++;
+
+    if (status == JOB_DONE || job.cancelled) {
+      job.running = false;
+
+      #ifdef USE_CONSOLE_STATS
+      recordCommandRun(job.commandIndex,job.busyMicros,0);
+      #endif
+
+      if (job.cancelled || !job.foreground) {
+        printJobName(slot);
+        consoleOutput.println(job.cancelled ? F(" cancelled") : F(" finished"));
+      }
+    }
+
+    consoleOutput.use(previousConsole);
+  }
+}
+
+
+// whether a console has jobs which aren't sleeping (so it has work to do)
+bool jobsAwake(ConsoleBase* console) {
+  for (int slot = 0; slot < MAX_JOBS; slot++) {
+    if (jobs[slot].running && jobs[slot].console == console && (jobs[slot].cancelled || (long)(millis() - jobs[slot].wakeMs) >= 0)) return true;
+  }
+
+  return false;
+}
+
+
+// cancels the foreground jobs of a console (ctrl-c)
+// returns whether there were any
+bool cancelForegroundJobs(ConsoleBase* console) {
+  bool found = false;
+
+  for (int slot = 0; slot < MAX_JOBS; slot++) {
+    if (!jobs[slot].running || !jobs[slot].foreground || jobs[slot].console != console) continue;
+
+    jobs[slot].cancelled = true;
+    found = true;
+  }
+
+  return found;
+}
+#endif
+
+
+// calls a command's function with the given (already checked) parameters
+void callCommand(int commandIndex, const Command &command, CommandArgs &args) {
+
+  consoleOutput.flush(); // so output the command prints directly to the serial interface comes after it
+
+  #ifdef USE_CONSOLE_STATS
+  unsigned long startMicros = micros();
+  unsigned long startBytes = consoleOutput.bytesWritten;
+  #endif
+
+  #ifdef USE_CONSOLE_JOBS
+  if (command.jobFunction) {
+    startJob(commandIndex,args); // (its statistics are recorded when it ends)
+    return;
+  }
+  #endif
+
+  if (command.argsFunction) {
+    command.argsFunction(args);
+
+  } else {
+    char parameters[MAX_PARAMETERS][MAX_PARAMETER_LENGTH];
+    copyParameters(args,parameters);
+    command.function(parameters);
+  }
+
+  #ifdef USE_CONSOLE_STATS
+  recordCommandRun(commandIndex,micros()-startMicros,consoleOutput.bytesWritten-startBytes);
+  #endif
+}
+
+
+// ends the text at the first COMMAND_SEPARATOR which isn't inside quotes
+// returns where the next command starts, or NULL if there is no separator
+char* splitCommands(char* text) {
+  bool quoted = false;
+
+  for (; *text != '\0'; text++) {
+    if (*text == QUOTE) quoted = !quoted;
+
+    if (*text == COMMAND_SEPARATOR && !quoted) {
+      *text = '\0';
+      return text+1;
+    }
+  }
+
+  return NULL;
+}
+
+
+// runs one command given as text (the text is split up in place)
+// what it prints goes through consoleOutput
+void runCommand(char* text, char delimiter = DELIMITER[0]) {
+
+  // split the input into the command and its parameters
+  char* tokens[MAX_PARAMETERS+1];
+  uint8_t lengths[MAX_PARAMETERS+1];
+  int tokenNum = tokenize(text,tokens,lengths,MAX_PARAMETERS+1,delimiter);
+
+  if (tokenNum == 0) {
+    tokens[0] = text; // empty line
+    tokenNum = 1;
+  }
+
+
+  // identify the command being executed
+  int commandIndex = findCommandIndex(tokens[0]);
+
+  if (commandIndex == commandCount()) {
+    #ifdef USE_CONSOLE_ALIASES
+    if (tokenNum == 1 && runAlias(tokens[0],delimiter)) return; // (only looked for once it isn't a command, so commands don't read the eeprom)
+    #endif
+
+    printUnknownCommand(tokens[0]);
+    return;
+  }
+
+  Command command = getCommand(commandIndex);
+
+
+  CommandArgs args;
+  args.count = min(tokenNum-1,(int)command.maxParameters);
+
+  for (int i = 0; i < MAX_PARAMETERS; i++) {
+    if (i < args.count) {
+      args.values[i] = tokens[i+1];
+      args.lengths[i] = lengths[i+1];
+    } else {
+      args.values[i] = (char*)"";
+      args.lengths[i] = 0;
+    }
+  }
+
+
+  // run command
+  if (!checkParameters(args,command)) {
+    #ifdef USE_CONSOLE_STATS
+    recordParseFailure(commandIndex);
+    #endif
+    return;
+  }
+
+  #ifndef NO_PARAMETER_SPECS
+  if (command.parameterSpecs) {
+    int badParameter = parseParameters(args,command);
+
+    if (badParameter >= 0) {
+      printParameterError(command,badParameter,args.values[badParameter]);
+      #ifdef USE_CONSOLE_STATS
+      recordParseFailure(commandIndex);
+      #endif
+      return;
+    }
+  }
+  #endif
+
+  callCommand(commandIndex,command,args);
+}
+
+
+// runs the command(s) of the line in the input buffer, from text on, then shows the prompt
+// several commands can be entered on one line, separated by COMMAND_SEPARATOR
+// if a command starts a listing, the rest wait in remainingCommands until it has been printed (see continueListing())
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::runCommandLine(char* text) {
+
+  ConsoleBase* previousConsole = consoleOutput.use(this); // commands print to this console
+  runningLine = true;
+
+  while (text && !listing.printLine) {
+    char* next = splitCommands(text);
+
+    // empty commands between separators are skipped; an empty line gets the usual message
+    bool empty = true;
+    for (char* c = text; *c != '\0' && empty; c++) empty = *c == ' ' || *c == Config::delimiter;
+
+    if (!empty || (text == inputBuffer && next == NULL)) runCommand(text,Config::delimiter);
+
+    consoleYield();
+    text = next;
+  }
+
+  runningLine = false;
+  consoleOutput.use(previousConsole);
+
+  remainingCommands = text;
+  lastInputMs = millis(); // don't count time spent running the commands towards the timeout
+
+  if (listing.printLine) return; // the prompt comes after the listing
+
+  #ifdef USE_BINARY_PROTOCOL
+  if (binaryMode) return; // no prompt once @binary has run
+  #endif
+
+  startNewLine();
+}
+
+
+// prints the next lines of the listing, as far as the serial interface takes them without blocking (see startListing())
+// a line is only printed while the serial interface has room for it, so output doesn't wait for room
+// input which arrives meanwhile is kept for afterwards, apart from ctrl-c (and the pager's keys)
+// ctrl-c (anywhere in the received input, which is dropped up to it) also drops the rest of the line's commands; q only stops the listing
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::continueListing() {
+
+  if (listing.paused) {
+    char key = 'q'; // (if nobody presses a key, the listing stops and the session times out as usual)
+
+    if (rxAvailable()) {
+      key = rxRead();
+      lastInputMs = millis();
+    } else if (millis() - lastInputMs < CONSOLE_CONTROL_TIMEOUT_MS) {
+      return;
+    }
+
+    output.print(F("\r          \r")); // clear the pager's prompt
+    listing.paused = false;
+    listing.pageLines = 0;
+
+    if (key == 'q' || key == CANCEL) listing.printLine = NULL;
+
+    if (key == CANCEL) {
+      output.println(F("^C"));
+      remainingCommands = NULL;
+    }
+  }
+
+  if (listing.printLine && rxTakeCancel()) {
+    output.println(F("^C"));
+    listing.printLine = NULL;
+    remainingCommands = NULL;
+  }
+
+  ConsoleBase* previousConsole = consoleOutput.use(this);
+
+  for (int i = 0; i < CONSOLE_POLL_MAX_LINES && listing.printLine; i++) {
+    if (!output.ready()) break; // the serial interface hasn't got room for more yet
+
+    if (!listing.printLine(consoleOutput,listing.line++)) {
+      listing.printLine = NULL;
+      break;
+    }
+
+    if (LISTING_PAGE_LINES > 0 && ++listing.pageLines >= LISTING_PAGE_LINES) {
+      output.print(F("-- more --"));
+      listing.paused = true;
+      break;
+    }
+  }
+
+  consoleOutput.use(previousConsole);
+
+  if (listing.printLine) return;
+
+  // the listing has ended: carry on with the line
+  if (remainingCommands) runCommandLine(remainingCommands);
+  else startNewLine();
+}
+
+
+// clears the input buffer and shows the prompt for a new command
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::startNewLine() {
+  consoleHistoryIndex = 0;
+  consoleInputIndex = 0;
+  inputEnd = 0;
+  lineReady = false;
+
+  if (rxStats.overflows != reportedOverflows) {
+    output.print('(');
+    output.print(rxStats.overflows - reportedOverflows);
+    output.println(F(" characters were lost: input arrived faster than it was handled)"));
+    reportedOverflows = rxStats.overflows;
+  }
+
+  // while input is queued up (a paste arriving faster than its echo can be sent), lines are taken in without echo,
+  // so the console doesn't wait for output while received bytes pile up; the echo comes back once it catches up,
+  // and what was skipped is reported once nothing is waiting (so the report doesn't hold up the rest of the paste)
+  output.skipEcho = CONSOLE_ECHO_SKIP_BYTES > 0 && rxCount > CONSOLE_ECHO_SKIP_BYTES;
+
+  if (rxCount == 0 && output.echoSkipped > 0) {
+    output.print('(');
+    output.print(output.echoSkipped);
+    output.println(F(" characters weren't echoed: input arrived faster than it could be shown)"));
+    output.echoSkipped = 0;
+  }
+
+  output.echo(ENTRY_PREFIX);
+}
+
+
+// ends the console session, leaving the serial port to the application until more input arrives
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::endConsoleSession() {
+
+  #ifdef USE_BINARY_PROTOCOL
+  if (!binaryMode) output.println();
+  binaryMode = false;
+  binaryLength = 0;
+  #else
+  output.println();
+  #endif
+
+  #if defined(USE_EEPROM_WRITE_BACK) && defined(EEPROM_COMMIT_WHEN_IDLE)
+  commitVariables();
+  #endif
+
+  consoleActive = false;
+  lineReady = false;
+  escapeState = ESC_STATE_NONE;
+}
+
+
+// handles the input which has arrived (poll() has just received it) and runs finished commands
+// returns whether a console session is active
+template <typename StreamType, typename Config>
+bool ConsoleControl<StreamType,Config>::advanceConsole() {
+
+  // a listing holds up the line editor until it has been printed
+  if (listing.printLine) {
+    continueListing();
+    return true;
+  }
+
+  // run a finished command before taking in more input
+  if (lineReady) {
+    lineReady = false;
+    
+    output.echo(F("\r\n"));
+    inputBuffer[inputEnd] = '\0';
+    pushHistory(inputBuffer,inputEnd); // store in the history (before the input buffer is split up)
+    runCommandLine(inputBuffer);
+
+    if (listing.printLine) return true;
+    #ifdef USE_BINARY_PROTOCOL
+    if (binaryMode) return true;
+    #endif
+    // otherwise carry on with the input waiting, so a pasted line doesn't take two polls (the second only to run it)
+  }
+
+
+  if (!consoleActive) {
+    if (!rxAvailable()) return false;
+
+    consoleActive = true;
+    lastInputMs = millis();
+
+    #ifdef USE_BINARY_PROTOCOL
+    binaryMode = rxPeek() == BINARY_FRAME_START; // a session starting with a frame is a binary session
+    if (!binaryMode) startNewLine();
+    #else
+    startNewLine();
+    #endif
+  }
+
+  #ifdef USE_BINARY_PROTOCOL
+  if (binaryMode) return advanceBinary();
+  #endif
+
+
+  for (int i = 0; i < CONSOLE_POLL_MAX_BYTES && !lineReady && rxAvailable(); i++) {
+
+    char inputChar = rxRead();
+    lastInputMs = millis();
+
+    #ifdef USE_CONSOLE_STATS
+    consoleStats.keystrokes++;
+    #endif
+
+    if (escapeState == ESC_STATE_NONE || !readEscapeCharacter(inputChar)) {
+      editLine(inputChar);
+    }
+  }
+
+
+  unsigned long now = millis();
+
+  // once no more characters have arrived for ESC_CODE_MS, a lone escape exits and an unfinished sequence is dropped
+  // (characters still waiting to be read don't count as a gap, in case consolePoll() isn't called often)
+  if (escapeState != ESC_STATE_NONE && now - escapeMs >= ESC_CODE_MS && !rxAvailable()) {
+    
+    if (escapeState == ESC_STATE_STARTED) { // escape pressed alone, exit console mode
+      endConsoleSession();
+      return false;
+    }
+    
+    escapeState = ESC_STATE_NONE;
+  }
+
+  if (now - lastInputMs >= CONSOLE_CONTROL_TIMEOUT_MS) {
+    endConsoleSession();
+    return false;
+  }
+
+  return true;
+}
+
+
+// services the console without blocking; call this every loop() (consolePoll() does it for the default console)
+// handles only the characters which have already arrived (at most CONSOLE_POLL_MAX_BYTES), then returns
+// a finished command is run at the start of the following call, so each call does a small, bounded amount of work
+// the echo of everything handled is sent with a single write(), as far as the serial interface has room for it
+// a console session starts once serial data is detected and ends when escape is pressed or after CONSOLE_CONTROL_TIMEOUT_MS without input
+// returns whether a console session is active
+template <typename StreamType, typename Config>
+bool ConsoleControl<StreamType,Config>::poll() {
+  unsigned long startMicros = micros();
+
+  receive();
+  bool busy = lineReady || rxAvailable(); // whether this call has something to handle
+
+  bool active = advanceConsole();
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  if (EEPROM_COMMIT_DEADLINE_MS > 0 && writeBackStats.pendingBytes > 0 && millis() - pendingSinceMs >= EEPROM_COMMIT_DEADLINE_MS) {
+    commitVariables();
+  }
+  #endif
+
+  #ifdef USE_EEPROM_LOG
+  stepEepromLog();
+  #endif
+
+  #ifdef USE_CONSOLE_JOBS
+  stepJobs(this);
+  #endif
+
+  output.flushAvailable();
+
+  unsigned long elapsed = micros() - startMicros;
+  if (busy) activeTime.add(elapsed);
+  else if (active) idleTime.add(elapsed);
+
+  #ifdef USE_CONSOLE_STATS
+  consoleStats.consoleTime.add(elapsed);
+  #endif
+
+  return active;
+}
+
+
+// whether the console has nothing to do until more input arrives (so the MCU can sleep, see consoleIdleHook)
+template <typename StreamType, typename Config>
+bool ConsoleControl<StreamType,Config>::idle() {
+  #ifdef USE_CONSOLE_JOBS
+  if (jobsAwake(this)) return false;
+  #endif
+
+  if (listing.printLine && !listing.paused) return false;
+
+  return !lineReady && rxCount == 0 && !stream.available();
+}
+
+
+// blocking version of poll() (runSerialCommands() does it for the default console)
+// starts once incoming serial data is detected and does not return until the console session ends (press escape to exit)
+// executes commands incoming on the serial port
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::run() {
+  receive();
+
+  if (!rxAvailable()) {
+    return;
+  }
+
+  while (poll()) {
+    if (!idle()) continue;
+
+    unsigned long startMicros = micros();
+    consoleIdleHook();
+    idleTime.add(micros() - startMicros);
+  }
+
+  output.flush();
+}
+
+
+// services the default console without blocking; call this every loop() (see ConsoleControl::poll())
+// returns whether a console session is active
+bool consolePoll() {
+  return defaultConsole.poll();
+}
+
+
+// runs the default console until its session ends (see ConsoleControl::run())
+void runSerialCommands() {
+  defaultConsole.run();
+}
+
+
+// whether the default console has nothing to do until more input arrives
+// a sketch which only calls consolePoll() can sleep when this is true (and its own work is done); a received byte wakes it
+bool consoleIdle() {
+  return defaultConsole.idle();
+}
+
+
+
+#if defined(USE_BINARY_PROTOCOL) || defined(USE_EEPROM_LOG) || defined(USE_VARIABLE_IMAGE) || defined(USE_CONSOLE_ALIASES)
+// CRC-16/CCITT (polynomial 0x1021, starting at 0xFFFF)
+uint16_t crc16(const uint8_t* data, int length, uint16_t crc = 0xFFFF) {
+  for (int i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+
+  return crc;
+}
+#endif
+
+
+
+#ifndef NO_EEPROM
+
+
+// sets or clears one flag in an array of bits
+void setFlag(uint8_t* flags, int index, bool value) {
+  if (value) flags[index/8] |= 1 << (index%8);
+  else flags[index/8] &= ~(1 << (index%8));
+}
+
+
+// reads one flag from an array of bits
+bool getFlag(const uint8_t* flags, int index) {
+  return flags[index/8] & (1 << (index%8));
+}
+
+
+// checks if a variable at a given address has been changed
+// if clearFlag is set, it will also set the modified flag to false afterwards
+bool variableModified(int address, bool clearFlag = false) {
+  int variableIndex = findVariableAtAddress(address);
+  
+  if (variableIndex == variableNum) {
+    //SERIAL_INTERFACE.println("isVariableModified() being called on nonexistant variable!");
+    return false;
+  }
+
+  bool modified = getFlag(changedVariables,variableIndex);
+
+  if (clearFlag) setFlag(changedVariables,variableIndex,false);
+
+  return modified;
+}
+
+
+// gives the indexes of all variables changed since the last call (up to maxIndexes of them), clearing their flags
+// returns how many were written to indexes; call it again if that is maxIndexes
+// instead of checking each variable every loop: int changed[4]; int changedNum = takeChangedVariables(changed,4);
+int takeChangedVariables(int* indexes, int maxIndexes) {
+  int found = 0;
+
+  for (int i = 0; i < (variableNum+7)/8 && found < maxIndexes; i++) {
+    if (changedVariables[i] == 0) continue; // skips 8 unchanged variables at a time
+
+    for (int variableIndex = i*8; variableIndex < i*8+8 && found < maxIndexes; variableIndex++) {
+      if (!getFlag(changedVariables,variableIndex)) continue;
+
+      setFlag(changedVariables,variableIndex,false);
+      indexes[found++] = variableIndex;
+    }
+  }
+
+  return found;
+}
+
+
+// sets a function to be called whenever a variable's value changes (through @put, a ConsoleVar, or anything else which stores a value)
+// the function is given the variable's index in variables[]
+// returns false if the variable doesn't exist
+bool onVariableChange(const char* name, void (*callback)(int variableIndex)) {
+  int variableIndex = findVariableIndex(name);
+
+  if (variableIndex == variableNum) return false;
+
+  variableCallbacks[variableIndex] = callback;
+  return true;
+}
+
+
+// flags a variable as changed and tells its callback
+void markVariableChanged(int variableIndex) {
+  setFlag(changedVariables,variableIndex,true);
+
+  if (variableCallbacks[variableIndex]) variableCallbacks[variableIndex](variableIndex);
+}
+
+
+// writes a block of bytes to the eeprom (the block must be within one page)
+// returns how many writes it took (one per byte without EEPROM_WRITE_BLOCK)
+int writeEepromBlock(int address, const uint8_t* data, int length) {
+  #ifdef EEPROM_WRITE_BLOCK
+  EEPROM_WRITE_BLOCK(address,data,length);
+  return 1;
+  #else
+  for (int i = 0; i < length; i++) eepromPut(address+i,data[i]);
+  return length;
+  #endif
+}
+
+
+// writes bytes to the eeprom, in blocks split at page boundaries
+void writeEepromBytes(int address, const uint8_t* data, int length) {
+  while (length > 0) {
+    int count = min(length,EEPROM_PAGE_SIZE - address % EEPROM_PAGE_SIZE);
+    writeEepromBlock(address,data,count);
+
+    address += count;
+    data += count;
+    length -= count;
+  }
+}
+
+
+#if defined(USE_EEPROM_LOG) || defined(USE_CONSOLE_ALIASES)
+uint8_t readEepromByte(int address) {
+  uint8_t value;
+  eepromGet(address,value);
+  return value;
+}
+
+
+uint16_t readEeprom16(int address) {
+  return readEepromByte(address) | (readEepromByte(address+1) << 8);
+}
+#endif
+
+
+#ifdef USE_EEPROM_LOG
+/* -- -- -- -- -- -- EEPROM log -- -- -- -- -- -- */
+
+// the log region is split into EEPROM_LOG_SEGMENTS segments, used in turn like a ring
+// a segment starts with a header: EEPROM_LOG_MAGIC, 16 bit sequence number (low byte first), check byte
+// then records follow: 16 bit payload length, payload, CRC-16 of the segment's sequence number, the length and the payload
+// a payload is one or more values: 16 bit variable address, size, value bytes
+//
+// a record is only valid if its CRC matches, so a record torn by a power loss is ignored (with any other values written with it),
+// as is whatever an older use of the segment left behind it (the sequence number is part of the CRC); nothing needs erasing
+// the latest record holding a variable wins; rebuildEepromLog() finds them at startup, scanning from the oldest segment
+// when fewer than two segments are free, stepEepromLog() compacts the oldest segment a record at a time:
+// values which are still the latest are copied to the head, then the segment is freed by clearing its header
+
+#define EEPROM_LOG_MAGIC 0x4C
+#define LOG_HEADER_SIZE 4 // bytes of a segment header
+#define LOG_RECORD_OVERHEAD 4 // bytes of a record besides its payload (length and CRC)
+#define LOG_VALUE_OVERHEAD 3 // bytes of a value besides its data (address and size)
+
+
+static_assert(EEPROM_LOG_SEGMENTS >= 3 && EEPROM_LOG_SEGMENTS <= 255, "EEPROM_LOG_SEGMENTS must be from 3 to 255");
+static_assert(EEPROM_LOG_SEGMENT_SIZE >= LOG_HEADER_SIZE + LOG_RECORD_OVERHEAD + LOG_VALUE_OVERHEAD + sizeof(double), "EEPROM_LOG_SEGMENT_SIZE is too small for a record");
+
+
+// collects bytes written to the log into blocks within one page, as commitVariables() does, and keeps the CRC of everything written
+struct LogWriter {
+  int address; // where the next byte goes
+  uint16_t crc;
+  uint8_t block[EEPROM_PAGE_SIZE];
+  int blockLength = 0;
+  int writes = 0; // eeprom writes made so far
+
+  LogWriter(int address, uint16_t sequence) : address(address) {
+    uint8_t sequenceBytes[2] = {(uint8_t)(sequence & 0xFF),(uint8_t)(sequence >> 8)};
+    crc = crc16(sequenceBytes,2);
+  }
+
+  void write(uint8_t value) {
+    crc = crc16(&value,1,crc);
+    block[blockLength++] = value;
+    address++;
+
+    if (address % EEPROM_PAGE_SIZE == 0) flush();
+  }
+
+  void write16(uint16_t value) {
+    write(value & 0xFF);
+    write(value >> 8);
+  }
+
+  // ends the record with its CRC and writes out the rest
+  void finish() {
+    uint16_t recordCrc = crc;
+    write16(recordCrc);
+    flush();
+  }
+
+  void flush() {
+    if (blockLength == 0) return;
+
+    writes += writeEepromBlock(address - blockLength,block,blockLength);
+    eepromLogStats.logBytes += blockLength;
+    blockLength = 0;
+  }
+};
+
+
+int logSegmentAddress(int segment) {
+  return EEPROM_LOG_START + segment * EEPROM_LOG_SEGMENT_SIZE;
+}
+
+
+// how many segments hold records (from the tail to the head)
+int usedLogSegments() {
+  if (logOffset == 0) return 0;
+  return (logHead - logTail + EEPROM_LOG_SEGMENTS) % EEPROM_LOG_SEGMENTS + 1;
+}
+
+
+// checks the record at an offset in a segment with the given sequence number
+// returns its payload length, or 0 if there is no valid record there (the end of the segment's records)
+int checkLogRecord(int segment, int offset, uint16_t sequence) {
+  if (offset + LOG_RECORD_OVERHEAD > EEPROM_LOG_SEGMENT_SIZE) return 0;
+
+  int address = logSegmentAddress(segment) + offset;
+  int length = readEeprom16(address);
+  if (length == 0 || offset + LOG_RECORD_OVERHEAD + length > EEPROM_LOG_SEGMENT_SIZE) return 0;
+
+  uint8_t header[4] = {(uint8_t)(sequence & 0xFF),(uint8_t)(sequence >> 8),(uint8_t)(length & 0xFF),(uint8_t)(length >> 8)};
+  uint16_t crc = crc16(header,4);
+  for (int i = 0; i < length; i++) {
+    uint8_t value = readEepromByte(address + 2 + i);
+    crc = crc16(&value,1,crc);
+  }
+
+  return readEeprom16(address + 2 + length) == crc ? length : 0;
+}
+
+
+// reads the segment headers and the records of the segments in use, finding the latest value of each registered variable
+// called on the first access to a variable, and again after a variable is registered (compaction only keeps values of registered variables)
+// takes about one eeprom read per byte of the log in use (see eepromLogStats.rebuildMicros)
+void rebuildEepromLog() {
+  unsigned long startMicros = micros();
+
+  memset(variableLocations,0,sizeof(variableLocations));
+  logReady = true;
+  logOffset = 0;
+  eepromLogStats.rebuildRecords = 0;
+
+  // the newest valid segment is the head
+  uint16_t sequences[EEPROM_LOG_SEGMENTS];
+  uint8_t validSegments[(EEPROM_LOG_SEGMENTS+7)/8] = {};
+  int newest = -1;
+
+  for (int segment = 0; segment < EEPROM_LOG_SEGMENTS; segment++) {
+    int address = logSegmentAddress(segment);
+    uint8_t magic = readEepromByte(address);
+    sequences[segment] = readEeprom16(address+1);
+
+    if (magic != EEPROM_LOG_MAGIC || readEepromByte(address+3) != (uint8_t)~(magic ^ sequences[segment] ^ (sequences[segment] >> 8))) continue;
+
+    setFlag(validSegments,segment,true);
+    if (newest < 0 || (int16_t)(sequences[segment] - sequences[newest]) > 0) newest = segment;
+  }
+
+  if (newest >= 0) {
+    logHead = newest;
+    logTail = newest;
+    logSequence = sequences[newest];
+
+    // the segments in use are the ones before it with consecutive sequence numbers
+    for (int i = 1; i < EEPROM_LOG_SEGMENTS; i++) {
+      int previous = (logTail + EEPROM_LOG_SEGMENTS - 1) % EEPROM_LOG_SEGMENTS;
+      if (!getFlag(validSegments,previous) || sequences[previous] != (uint16_t)(sequences[logTail] - 1)) break;
+      logTail = previous;
+    }
+
+    for (int segment = logTail; ; segment = (segment + 1) % EEPROM_LOG_SEGMENTS) {
+      int offset = LOG_HEADER_SIZE;
+
+      while (int length = checkLogRecord(segment,offset,sequences[segment])) {
+        int address = logSegmentAddress(segment) + offset + 2;
+        int end = address + length;
+
+        while (address + LOG_VALUE_OVERHEAD <= end) {
+          int variableIndex = findVariableAtAddress(readEeprom16(address));
+          uint8_t size = readEepromByte(address+2);
+
+          if (variableIndex < variableNum && size == typeSizes[variables[variableIndex].type]) variableLocations[variableIndex] = address + LOG_VALUE_OVERHEAD;
+          address += LOG_VALUE_OVERHEAD + size;
+        }
+
+        offset += LOG_RECORD_OVERHEAD + length;
+        eepromLogStats.rebuildRecords++;
+      }
+
+      if (segment == logHead) {
+        logOffset = offset; // a torn record at the end is written over
+        break;
+      }
+    }
+  }
+
+  compactOffset = LOG_HEADER_SIZE;
+  eepromLogStats.rebuildMicros = micros() - startMicros;
+}
+
+
+// starts using the next segment
+void openLogSegment() {
+  if (logOffset == 0) { // nothing in use
+    logHead = logTail;
+    compactOffset = LOG_HEADER_SIZE;
+  } else {
+    logHead = (logHead + 1) % EEPROM_LOG_SEGMENTS;
+  }
+
+  logSequence++;
+
+  LogWriter header(logSegmentAddress(logHead),0);
+  header.write(EEPROM_LOG_MAGIC);
+  header.write16(logSequence);
+  header.write(~(EEPROM_LOG_MAGIC ^ logSequence ^ (logSequence >> 8)));
+  header.flush();
+
+  logOffset = LOG_HEADER_SIZE;
+}
+
+
+bool compactEepromLog();
+
+
+// finds room for a record with a payload of length bytes, opening the next segment if it doesn't fit in the head one
+// returns its eeprom address, or 0 if the log is full (the latest values take up too many segments)
+int reserveLogRecord(int length, bool compacting) {
+  
+  if (logOffset == 0 || logOffset + LOG_RECORD_OVERHEAD + length > EEPROM_LOG_SEGMENT_SIZE) {
+    
+    // the last free segment is kept for compaction, so finish compacting the oldest segment first
+    if (!compacting) while (EEPROM_LOG_SEGMENTS - usedLogSegments() <= 1 && compactEepromLog()) {}
+
+    if (logOffset == 0 || logOffset + LOG_RECORD_OVERHEAD + length > EEPROM_LOG_SEGMENT_SIZE) { // (compaction may have moved on to a new segment)
+      if (usedLogSegments() == EEPROM_LOG_SEGMENTS) {
+        consoleOutput.println(F("EEPROM log is full. Increase EEPROM_LOG_SEGMENTS or EEPROM_LOG_SEGMENT_SIZE."));
+        return 0;
+      }
+
+      openLogSegment();
+    }
+  }
+
+  int address = logSegmentAddress(logHead) + logOffset;
+  logOffset += LOG_RECORD_OVERHEAD + length;
+  return address;
+}
+
+
+// appends the current values of the variables whose flag is set (or just variableIndex, if flags is NULL)
+// they go in as few records as fit in a segment; each record is written whole or not at all
+// returns how many eeprom writes it took (not counting any compaction needed to make room)
+int appendLogRecords(const uint8_t* flags, int variableIndex) {
+  if (!logReady) rebuildEepromLog();
+
+  int writes = 0;
+  int first = flags ? 0 : variableIndex;
+  int last = flags ? variableNum : variableIndex + 1;
+
+  while (first < last) {
+
+    // take as many values as fit in one record
+    int length = 0;
+    int end = first;
+    for (; end < last; end++) {
+      if (flags && !getFlag(flags,end)) continue;
+
+      int valueLength = LOG_VALUE_OVERHEAD + typeSizes[variables[end].type];
+      if (length > 0 && LOG_HEADER_SIZE + LOG_RECORD_OVERHEAD + length + valueLength > EEPROM_LOG_SEGMENT_SIZE) break;
+      length += valueLength;
+    }
+
+    if (length == 0) break;
+
+    int address = reserveLogRecord(length,false);
+    if (address == 0) break;
+
+    LogWriter writer(address,logSequence);
+    writer.write16(length);
+
+    for (int i = first; i < end; i++) {
+      if (flags && !getFlag(flags,i)) continue;
+
+      uint8_t size = typeSizes[variables[i].type];
+      writer.write16(variables[i].address);
+      writer.write(size);
+      variableLocations[i] = writer.address;
+
+      for (int j = 0; j < size; j++) writer.write(variableValues[i].bytes[j]);
+      eepromLogStats.valueBytes += size;
+    }
+
+    writer.finish();
+    eepromLogStats.records++;
+    writes += writer.writes;
+
+    first = end;
+  }
+
+  return writes;
+}
+
+
+// compacts one record of the oldest segment, copying the values in it which are still the latest to the head
+// frees the segment once all its records are done
+// returns false if there is nothing to compact (only the head segment is in use)
+bool compactEepromLog() {
+  if (usedLogSegments() < 2) return false;
+
+  int segmentAddress = logSegmentAddress(logTail);
+  uint16_t sequence = logSequence - (usedLogSegments() - 1);
+  int length = checkLogRecord(logTail,compactOffset,sequence);
+
+  if (length == 0) { // no more records: free the segment
+    LogWriter header(segmentAddress,0);
+    header.write(0);
+    header.flush();
+
+    logTail = (logTail + 1) % EEPROM_LOG_SEGMENTS;
+    compactOffset = LOG_HEADER_SIZE;
+    eepromLogStats.compactions++;
+    return true;
+  }
+
+  int start = segmentAddress + compactOffset + 2;
+  int end = start + length;
+
+  // the values which are still the latest, and the space they take
+  int liveLength = 0;
+  for (int address = start; address + LOG_VALUE_OVERHEAD <= end; address += LOG_VALUE_OVERHEAD + readEepromByte(address+2)) {
+    int variableIndex = findVariableAtAddress(readEeprom16(address));
+    if (variableIndex < variableNum && variableLocations[variableIndex] == address + LOG_VALUE_OVERHEAD) liveLength += LOG_VALUE_OVERHEAD + readEepromByte(address+2);
+  }
+
+  // the record is only done with once its live values are safely in the head (if there's no room for them, it is kept)
+  if (liveLength == 0) {
+    compactOffset += LOG_RECORD_OVERHEAD + length;
+    return true;
+  }
+
+  int recordAddress = reserveLogRecord(liveLength,true);
+  if (recordAddress == 0) return false;
+
+  LogWriter writer(recordAddress,logSequence);
+  writer.write16(liveLength);
+
+  for (int address = start; address + LOG_VALUE_OVERHEAD <= end; address += LOG_VALUE_OVERHEAD + readEepromByte(address+2)) {
+    int variableIndex = findVariableAtAddress(readEeprom16(address));
+    if (variableIndex == variableNum || variableLocations[variableIndex] != address + LOG_VALUE_OVERHEAD) continue;
+
+    uint8_t size = readEepromByte(address+2);
+    writer.write16(variables[variableIndex].address);
+    writer.write(size);
+    variableLocations[variableIndex] = writer.address;
+
+    for (int i = 0; i < size; i++) writer.write(readEepromByte(address + LOG_VALUE_OVERHEAD + i));
+    eepromLogStats.copiedBytes += size;
+  }
+
+  writer.finish();
+  compactOffset += LOG_RECORD_OVERHEAD + length;
+  return true;
+}
+
+
+// does a step of background compaction if fewer than two segments are free (called by consolePoll(), can also be called from loop())
+// returns whether it did anything
+bool stepEepromLog() {
+  if (!logReady || EEPROM_LOG_SEGMENTS - usedLogSegments() > 1) return false;
+
+  return compactEepromLog();
+}
+
+
+// prints the state of the eeprom log
+void logCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  if (!logReady) rebuildEepromLog();
+
+  consoleOutput.print(F("segments in use: "));
+  consoleOutput.print(usedLogSegments());
+  consoleOutput.print(F(" of "));
+  consoleOutput.print(EEPROM_LOG_SEGMENTS);
+  consoleOutput.print(F(", head segment: "));
+  consoleOutput.print(logOffset);
+  consoleOutput.print(F("/"));
+  consoleOutput.print(EEPROM_LOG_SEGMENT_SIZE);
+  consoleOutput.println(F(" bytes"));
+
+  consoleOutput.print(F("records: "));
+  consoleOutput.print(eepromLogStats.records);
+  consoleOutput.print(F(", value bytes: "));
+  consoleOutput.print(eepromLogStats.valueBytes);
+  consoleOutput.print(F(", log bytes: "));
+  consoleOutput.print(eepromLogStats.logBytes);
+  consoleOutput.print(F(", write amplification: "));
+  consoleOutput.println(eepromLogStats.valueBytes ? (double)eepromLogStats.logBytes / eepromLogStats.valueBytes : 0.0);
+
+  consoleOutput.print(F("compactions: "));
+  consoleOutput.print(eepromLogStats.compactions);
+  consoleOutput.print(F(", bytes copied: "));
+  consoleOutput.print(eepromLogStats.copiedBytes);
+  consoleOutput.print(F(", last rebuild: "));
+  consoleOutput.print(eepromLogStats.rebuildRecords);
+  consoleOutput.print(F(" records in "));
+  consoleOutput.print(eepromLogStats.rebuildMicros);
+  consoleOutput.println(F(" us"));
+}
+#endif
+
+
+// reads a variable's value from the eeprom
+// (with USE_EEPROM_LOG, from its latest record; 0 if it has none)
+VariableValue readStoredVariable(int variableIndex) {
+  VariableValue value;
+
+  #ifdef USE_EEPROM_LOG
+  if (!logReady) rebuildEepromLog();
+
+  int address = variableLocations[variableIndex];
+  if (address == 0) {
+    memset(&value,0,sizeof(value));
+    return value;
+  }
+  #else
+  int address = variables[variableIndex].address;
+  #endif
+
+  switch (variables[variableIndex].type) {
+    case 0:
+      eepromGet(address,value.asByte);
+      break;
+    case 1:
+      eepromGet(address,value.asDouble);
+      break;
+  }
+
+  return value;
+}
+
+
+// writes a variable's value to the eeprom
+// (with USE_EEPROM_LOG, appends a record holding it)
+void writeStoredVariable(int variableIndex, VariableValue value) {
+
+  #ifdef USE_EEPROM_LOG
+  variableValues[variableIndex] = value;
+  appendLogRecords(NULL,variableIndex);
+  #else
+  switch (variables[variableIndex].type) {
+    case 0:
+      eepromPut(variables[variableIndex].address,value.asByte);
+      break;
+    case 1:
+      eepromPut(variables[variableIndex].address,value.asDouble);
+      break;
+  }
+  #endif
+}
+
+
+// reads a variable's value from its RAM copy, loading it from eeprom the first time
+// (with USE_EEPROM_WRITE_BACK this is the pending value if it hasn't been committed yet)
+VariableValue readVariable(int variableIndex) {
+
+  if (!getFlag(loadedVariables,variableIndex)) {
+    variableValues[variableIndex] = readStoredVariable(variableIndex);
+    setFlag(loadedVariables,variableIndex,true);
+  }
+
+  return variableValues[variableIndex];
+}
+
+
+// loads every registered variable into RAM, so no eeprom reads happen later
+// optional: call it in setup() after registering variables to move the reads out of the control loop
+void loadVariables() {
+  for (int i = 0; i < variableNum; i++) readVariable(i);
+}
+
+
+// stores a variable's value
+// with USE_EEPROM_WRITE_BACK the value is held in RAM until it is committed, otherwise it is written to eeprom right away
+void writeVariable(int variableIndex, VariableValue value) {
+
+  variableValues[variableIndex] = value;
+  setFlag(loadedVariables,variableIndex,true);
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  if (writeBackStats.pendingBytes == 0) pendingSinceMs = millis();
+  if (!getFlag(pendingVariables,variableIndex)) writeBackStats.pendingBytes += typeSizes[variables[variableIndex].type];
+
+  setFlag(pendingVariables,variableIndex,true);
+
+  pendingPuts++;
+  writeBackStats.puts++;
+  #else
+  writeStoredVariable(variableIndex,value);
+  #endif
+
+  markVariableChanged(variableIndex);
+}
+
+
+// writes the RAM copies of the variables whose flag is set to the eeprom
+// values at neighbouring addresses are combined into one block write, split only at page boundaries
+// (with USE_EEPROM_LOG they go in one record if they fit in a segment, so they are stored together or not at all)
+// returns how many writes it took
+int storeVariables(const uint8_t* flags) {
+
+  #ifdef USE_EEPROM_LOG
+  return appendLogRecords(flags,0);
+  #else
+  uint8_t block[EEPROM_PAGE_SIZE]; // bytes waiting to be written
+  int blockAddress = 0; // eeprom address of block[0]
+  int blockLength = 0;
+  int writes = 0;
+
+  // go through the pending variables in address order
+  for (int position = 0; position < variableNum; position++) {
+
+    int variableIndex = variablesByAddress[position];
+    if (!getFlag(flags,variableIndex)) continue;
+
+    int lastAddress = variables[variableIndex].address;
+
+
+    // write out the block so far if this variable doesn't continue it
+    if (blockLength > 0 && blockAddress + blockLength != lastAddress) {
+      writes += writeEepromBlock(blockAddress,block,blockLength);
+      blockLength = 0;
+    }
+
+    for (int i = 0; i < typeSizes[variables[variableIndex].type]; i++) {
+      int address = lastAddress + i;
+
+      if (blockLength == 0) blockAddress = address;
+      block[blockLength++] = variableValues[variableIndex].bytes[i];
+
+      // blocks can't cross a page boundary
+      if ((address + 1) % EEPROM_PAGE_SIZE == 0) {
+        writes += writeEepromBlock(blockAddress,block,blockLength);
+        blockLength = 0;
+      }
+    }
+  }
+
+  if (blockLength > 0) {
+    writes += writeEepromBlock(blockAddress,block,blockLength);
+  }
+
+  return writes;
+  #endif
+}
+
+
+#ifdef USE_EEPROM_WRITE_BACK
+// writes all pending values to the eeprom
+void commitVariables() {
+
+  int writes = storeVariables(pendingVariables);
+  memset(pendingVariables,0,sizeof(pendingVariables));
+
+  writeBackStats.eepromWrites += writes;
+  writeBackStats.writesSaved += max(pendingPuts - writes,0);
+  writeBackStats.pendingBytes = 0;
+  pendingPuts = 0;
+}
+
+
+// discards all pending values (the RAM copies go back to what is in eeprom)
+void revertVariables() {
+  for (int i = 0; i < variableNum; i++) {
+    if (!getFlag(pendingVariables,i)) continue;
+
+    variableValues[i] = readStoredVariable(i);
+    setFlag(pendingVariables,i,false);
+    markVariableChanged(i);
+  }
+
+  writeBackStats.writesSaved += pendingPuts;
+  writeBackStats.pendingBytes = 0;
+  pendingPuts = 0;
+}
+
+
+// prints the write-back cache counters
+void printWriteBackStats() {
+  consoleOutput.print(F("pending bytes: "));
+  consoleOutput.print(writeBackStats.pendingBytes);
+  consoleOutput.print(F(", puts: "));
+  consoleOutput.print(writeBackStats.puts);
+  consoleOutput.print(F(", EEPROM writes: "));
+  consoleOutput.print(writeBackStats.eepromWrites);
+  consoleOutput.print(F(", writes saved: "));
+  consoleOutput.println(writeBackStats.writesSaved);
+}
+
+
+// writes the values stored with @put to eeprom
+void commitCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  consoleOutput.print(F("Committed "));
+  consoleOutput.print(writeBackStats.pendingBytes);
+  consoleOutput.println(F(" bytes"));
+
+  commitVariables();
+  printWriteBackStats();
+}
+
+
+// discards the values stored with @put since the last commit
+void revertCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  consoleOutput.print(F("Discarded "));
+  consoleOutput.print(writeBackStats.pendingBytes);
+  consoleOutput.println(F(" bytes"));
+
+  revertVariables();
+  printWriteBackStats();
+}
+#endif
+
+
+#ifdef USE_VARIABLE_IMAGE
+/* -- -- -- -- -- -- Variable images -- -- -- -- -- -- */
+
+// an image holds every registered variable: hash of the variable layout (2 bytes), the values in address order, CRC-16 of all of it
+// the layout hash covers each variable's name, type and address, so an image only loads into firmware with the same variables
+// @dump prints it as "@load,<offset>,<hex>" lines short enough for the input buffer; entering them (pasting them all at once)
+// hands the image to @load a piece at a time, and it is checked and stored once the last piece is in
+// values are stored together with storeVariables() (with USE_EEPROM_LOG, as one record if they fit in a segment)
+
+#define IMAGE_LINE_BYTES ((INPUT_BUFFER_SIZE - 12) / 2) // image bytes per @load line ("@load,<offset>," and 2 hex digits a byte)
+
+static_assert(IMAGE_LINE_BYTES >= 4, "INPUT_BUFFER_SIZE is too small for @load lines");
+
+
+// hash of the registered variables' names, types and addresses (in address order)
+uint16_t variableLayoutHash() {
+  uint16_t hash = 0xFFFF;
+
+  for (int position = 0; position < variableNum; position++) {
+    const eepromVariable &variable = variables[variablesByAddress[position]];
+    uint8_t layout[3] = {variable.type,(uint8_t)(variable.address & 0xFF),(uint8_t)(variable.address >> 8)};
+
+    hash = crc16((const uint8_t*)variable.name,strlen(variable.name)+1,hash);
+    hash = crc16(layout,3,hash);
+  }
+
+  return hash;
+}
+
+
+// bytes in an image of the registered variables
+int variableImageLength() {
+  int length = 4;
+  for (int i = 0; i < variableNum; i++) length += typeSizes[variables[i].type];
+  return length;
+}
+
+
+// prints image bytes as @load lines, starting a new line every IMAGE_LINE_BYTES bytes
+struct ImagePrinter {
+  int offset = 0;
+  uint16_t crc = 0xFFFF;
+
+  void write(uint8_t value) {
+    if (offset % IMAGE_LINE_BYTES == 0) {
+      if (offset > 0) consoleOutput.println();
+      consoleOutput.print(F("@load" DELIMITER));
+      consoleOutput.print(offset);
+      consoleOutput.print(F(DELIMITER));
+    }
+
+    const char* digits = "0123456789ABCDEF";
+    consoleOutput.print(digits[value >> 4]);
+    consoleOutput.print(digits[value & 0xF]);
+
+    crc = crc16(&value,1,crc);
+    offset++;
+  }
+};
+
+
+// prints all variables as an image (see "Variable images")
+// the values are read in address order (from RAM if they have been read before)
+void dumpCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  ImagePrinter printer;
+
+  uint16_t hash = variableLayoutHash();
+  printer.write(hash & 0xFF);
+  printer.write(hash >> 8);
+
+  for (int position = 0; position < variableNum; position++) {
+    int variableIndex = variablesByAddress[position];
+    VariableValue value = readVariable(variableIndex);
+
+    for (int i = 0; i < typeSizes[variables[variableIndex].type]; i++) printer.write(value.bytes[i]);
+  }
+
+  uint16_t crc = printer.crc;
+  printer.write(crc & 0xFF);
+  printer.write(crc >> 8);
+  consoleOutput.println();
+}
+
+
+// value of a hex digit, or -1 if it isn't one
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+
+// checks a complete image and stores its values
+void storeVariableImage() {
+  int length = variableImageLength();
+
+  if ((imageBuffer[0] | (imageBuffer[1] << 8)) != variableLayoutHash()) {
+    consoleOutput.println(F("The image is for different variables (names, types or addresses don't match). Nothing was stored."));
+    return;
+  }
+
+  if ((imageBuffer[length-2] | (imageBuffer[length-1] << 8)) != crc16(imageBuffer,length-2)) {
+    consoleOutput.println(F("The image is corrupted (CRC doesn't match). Nothing was stored."));
+    return;
+  }
+
+  uint8_t flags[(MAX_VARIABLES+7)/8];
+  memset(flags,0xFF,sizeof(flags));
+
+  const uint8_t* data = imageBuffer + 2;
+  for (int position = 0; position < variableNum; position++) {
+    int variableIndex = variablesByAddress[position];
+    int size = typeSizes[variables[variableIndex].type];
+
+    memcpy(variableValues[variableIndex].bytes,data,size);
+    setFlag(loadedVariables,variableIndex,true);
+    data += size;
+  }
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  // the image replaces any values waiting to be committed
+  writeBackStats.writesSaved += pendingPuts;
+  writeBackStats.pendingBytes = 0;
+  pendingPuts = 0;
+  memset(pendingVariables,0,sizeof(pendingVariables));
+  #endif
+
+  int writes = storeVariables(flags);
+
+  for (int i = 0; i < variableNum; i++) markVariableChanged(i);
+
+  consoleOutput.print(F("Loaded "));
+  consoleOutput.print(variableNum);
+  consoleOutput.print(F(" variables in "));
+  consoleOutput.print(writes);
+  consoleOutput.println(F(" EEPROM writes"));
+}
+
+
+// takes in a piece of a variable image: its offset in the image, and its bytes in hex
+// offset 0 starts a new image; pieces must follow on from each other
+void loadCommand(CommandArgs &args) {
+  #ifndef NO_PARAMETER_SPECS
+  int offset = args.parsed[0].asInt;
+  #else
+  int offset = atoi(args.values[0]);
+  #endif
+  int length = variableImageLength();
+
+  if (offset != 0 && offset != imageLength) {
+    consoleOutput.print(F("Expected the image piece at offset "));
+    consoleOutput.print(imageLength);
+    consoleOutput.println(F(". Start again from offset 0."));
+    imageLength = 0;
+    return;
+  }
+
+  if (args.lengths[1] % 2 != 0 || offset + args.lengths[1] / 2 > length) {
+    consoleOutput.println(F("The image piece doesn't fit the registered variables. Start again from offset 0."));
+    imageLength = 0;
+    return;
+  }
+
+  imageLength = offset;
+
+  for (int i = 0; i < args.lengths[1]; i += 2) {
+    int high = hexDigit(args.values[1][i]);
+    int low = hexDigit(args.values[1][i+1]);
+
+    if (high < 0 || low < 0) {
+      consoleOutput.print(F("'"));
+      consoleOutput.print(args.values[1]);
+      consoleOutput.println(F("' is not hex. Start again from offset 0."));
+      imageLength = 0;
+      return;
+    }
+
+    imageBuffer[imageLength++] = (high << 4) | low;
+  }
+
+  if (imageLength < length) return; // more to come
+
+  imageLength = 0;
+  storeVariableImage();
+}
+#endif
+
+
+#ifdef USE_CONSOLE_ALIASES
+/* -- -- -- -- -- -- Aliases -- -- -- -- -- -- */
+
+// the alias region starts with a header: hash of the registered command names (see commandLayoutHash()), bytes of records in use
+// then a record for each line of commands added to an alias: name length, body length, name, body
+// in a body each command is its command index (1 byte), then its parameters with each delimiter as ALIAS_DELIMITER, then a 0 byte,
+// so "@put,gain,1.5" takes 10 bytes, and "prep" runs a whole procedure
+// an alias runs the bodies of all its records, in the order they were added
+// a record is written before the header counts it, so one cut off by a power loss is ignored
+// deleting first cuts the count back to the records before the one deleted, so a power loss while the rest move down only loses those
+// if the records don't add up to the count (a corrupt region), there are taken to be none
+// command indexes depend on the commands registered, so the aliases are dropped if those change (the hash no longer matches)
+
+#define ALIAS_HEADER_SIZE 4
+#define ALIAS_RECORDS (ALIAS_EEPROM_START + ALIAS_HEADER_SIZE) // address of the first record
+#define ALIAS_DELIMITER 0x1F // stands for the delimiter in a stored body (so it runs on a console with another delimiter)
+
+static_assert(ALIAS_EEPROM_SIZE > ALIAS_HEADER_SIZE + 4, "ALIAS_EEPROM_SIZE is too small for an alias");
+#ifdef USE_EEPROM_LOG
+static_assert(ALIAS_EEPROM_START >= EEPROM_LOG_START + EEPROM_LOG_SEGMENTS * EEPROM_LOG_SEGMENT_SIZE || ALIAS_EEPROM_START + ALIAS_EEPROM_SIZE <= EEPROM_LOG_START,
+  "the ALIAS_EEPROM_* region overlaps the EEPROM_LOG_* region");
+#endif
+
+
+// hash of the registered command names in index order (which decides the command indexes)
+// kept until more commands are registered (commands are only ever added)
+uint16_t commandLayoutHash() {
+  static uint16_t hash;
+  static int hashedCount = -1;
+
+  if (hashedCount == commandCount()) return hash;
+
+  hash = 0xFFFF;
+  hashedCount = commandCount();
+
+  for (int commandIndex = 0; commandIndex < commandCount(); commandIndex++) {
+    Command command = getCommand(commandIndex);
+
+    for (const char* c = command.name;; c++) {
+      uint8_t value = command.flashStrings ? pgm_read_byte(c) : *c;
+      hash = crc16(&value,1,hash);
+      if (value == '\0') break;
+    }
+  }
+
+  return hash;
+}
+
+
+// address of the record after the one at address
+int nextAliasRecord(int address) {
+  return address + 2 + readEepromByte(address) + readEepromByte(address+1);
+}
+
+
+// bytes of alias records in use; 0 if there are none, -1 if the records were stored for other commands (they are dropped)
+int aliasBytesUsed() {
+  uint16_t used = readEeprom16(ALIAS_EEPROM_START+2);
+
+  if (used == 0 || used > ALIAS_EEPROM_SIZE - ALIAS_HEADER_SIZE) return 0; // (none, or blank eeprom)
+  if (readEeprom16(ALIAS_EEPROM_START) != commandLayoutHash()) return -1;
+
+  int record = ALIAS_RECORDS;
+  while (record < ALIAS_RECORDS + used) record = nextAliasRecord(record);
+  if (record != ALIAS_RECORDS + used) return 0; // (corrupt)
+
+  return used;
+}
+
+
+// writes the header, with the hash of the registered commands
+void setAliasBytesUsed(int used) {
+  uint16_t hash = commandLayoutHash();
+  uint8_t header[ALIAS_HEADER_SIZE] = {(uint8_t)(hash & 0xFF),(uint8_t)(hash >> 8),(uint8_t)(used & 0xFF),(uint8_t)(used >> 8)};
+
+  writeEepromBytes(ALIAS_EEPROM_START,header,ALIAS_HEADER_SIZE);
+}
+
+
+// whether the record at address belongs to the named alias
+bool aliasRecordIs(int address, const char* name) {
+  int length = readEepromByte(address);
+
+  for (int i = 0; i < length; i++) {
+    if (name[i] != (char)readEepromByte(address+2+i)) return false;
+  }
+
+  return name[length] == '\0';
+}
+
+
+// prints the command at address in a body ending at bodyEnd, with delimiter between its parameters
+// returns the address of the next command
+int printAliasCommand(Print &output, int address, int bodyEnd, char delimiter) {
+  int commandIndex = readEepromByte(address++);
+
+  if (commandIndex < commandCount()) {
+    Command command = getCommand(commandIndex);
+    printCommandString(output,command.name,command.flashStrings);
+  }
+
+  uint8_t value = address < bodyEnd ? readEepromByte(address++) : '\0';
+  if (value != '\0') output.write(delimiter); // (the delimiter after the name isn't stored)
+
+  for (; value != '\0'; value = address < bodyEnd ? readEepromByte(address++) : '\0') {
+    output.write(value == ALIAS_DELIMITER ? delimiter : value);
+  }
+
+  return address;
+}
+
+
+// runs the commands of an alias, if name is one (called by runCommand() for names which aren't commands)
+// a listing printed by one of them is printed at once, so it stays in order with the others
+// returns false if there is no such alias
+bool runAlias(const char* name, char delimiter) {
+  int end = ALIAS_RECORDS + max(aliasBytesUsed(),0);
+  bool found = false;
+
+  ConsoleBase* console = consoleOutput.console;
+  bool runningLine = console && console->runningLine;
+  if (console) console->runningLine = false;
+
+  for (int record = ALIAS_RECORDS; record < end; record = nextAliasRecord(record)) {
+    if (!aliasRecordIs(record,name)) continue;
+    found = true;
+
+    int address = record + 2 + readEepromByte(record);
+    int bodyEnd = address + readEepromByte(record+1);
+
+    while (address < bodyEnd) {
+      char line[INPUT_BUFFER_SIZE+1];
+      TextBuffer text(line,INPUT_BUFFER_SIZE);
+
+      address = printAliasCommand(text,address,bodyEnd,delimiter);
+      line[text.length] = '\0';
+
+      runCommand(line,delimiter);
+      consoleYield();
+    }
+  }
+
+  if (console) console->runningLine = runningLine;
+  return found;
+}
+
+
+// lines of the list of aliases printed by @alias (see startListing()): one for each record, then the room used
+// the records are checked once when the listing starts, and each line carries on from the record after the last one's
+bool printAliasLine(Print &output, int line) {
+  static int used; // aliasBytesUsed() when the listing started
+  static int record; // address of the record for nextLine (past end once the last line is printed)
+  static int nextLine = -1;
+
+  int end = ALIAS_RECORDS + max(used,0);
+
+  if (line != nextLine) { // a new listing (or another listing printed lines in between), so check the records and find this line's
+    used = aliasBytesUsed();
+    end = ALIAS_RECORDS + max(used,0);
+    record = ALIAS_RECORDS;
+
+    for (int recordNum = 0; recordNum < line; recordNum++) {
+      if (record >= end) return false; // (past the last line)
+      record = nextAliasRecord(record);
+    }
+  }
+
+  if (record > end) return false; // (past the last line)
+  nextLine = line + 1;
+
+  if (record == end) {
+    record = end + 1;
+
+    if (used < 0) {
+      output.println(F("No aliases (the stored ones were made for other commands, and have been dropped)"));
+    } else if (used == 0) {
+      output.println(F("No aliases"));
+    } else {
+      output.print(used);
+      output.print(F(" of "));
+      output.print(ALIAS_EEPROM_SIZE - ALIAS_HEADER_SIZE);
+      output.println(F(" bytes used"));
+    }
+
+    return true;
+  }
+
+  char delimiter = consoleOutput.console ? consoleOutput.console->delimiter : DELIMITER[0];
+  int nameLength = readEepromByte(record);
+
+  for (int i = 0; i < nameLength; i++) output.write(readEepromByte(record+2+i));
+  output.print(F(" = "));
+
+  int address = record + 2 + nameLength;
+  int bodyEnd = address + readEepromByte(record+1);
+
+  while (address < bodyEnd) {
+    address = printAliasCommand(output,address,bodyEnd,delimiter);
+    if (address < bodyEnd) output.print(COMMAND_SEPARATOR);
+  }
+
+  record = bodyEnd;
+  output.println();
+  return true;
+}
+
+
+// deletes every record of an alias, moving the ones after each down
+// returns how many it deleted
+int deleteAlias(const char* name) {
+  int used = max(aliasBytesUsed(),0);
+  int deleted = 0;
+
+  for (int record = ALIAS_RECORDS; record < ALIAS_RECORDS + used;) {
+    if (!aliasRecordIs(record,name)) {
+      record = nextAliasRecord(record);
+      continue;
+    }
+
+    int length = nextAliasRecord(record) - record;
+    uint8_t block[EEPROM_PAGE_SIZE];
+
+    setAliasBytesUsed(record - ALIAS_RECORDS); // (until the records after it have moved down)
+
+    for (int address = record; address + length < ALIAS_RECORDS + used; address += EEPROM_PAGE_SIZE) {
+      int count = min(EEPROM_PAGE_SIZE,ALIAS_RECORDS + used - address - length);
+      for (int i = 0; i < count; i++) block[i] = readEepromByte(address+length+i);
+      writeEepromBytes(address,block,count);
+    }
+
+    used -= length;
+    deleted++;
+    setAliasBytesUsed(used);
+  }
+
+  return deleted;
+}
+
+
+// adds a line of commands to an alias (making it if it's new), stored compactly (see "Aliases")
+// the commands must exist, and can't include @alias itself
+void addAlias(const char* name, char* commandText, char delimiter) {
+  uint8_t body[INPUT_BUFFER_SIZE+1];
+  int bodyLength = 0;
+  int aliasIndex = findCommandIndex("@alias");
+
+  char* text = commandText;
+
+  while (text) {
+    char* next = splitCommands(text);
+
+    char* parameters = strchr(text,delimiter);
+    if (parameters) *parameters++ = '\0';
+
+    if (*text != '\0') {
+      int commandIndex = findAndCheckCommandIndex(text);
+
+      if (commandIndex == commandCount()) return;
+
+      if (commandIndex == aliasIndex || commandIndex > 255) {
+        consoleOutput.print(text);
+        consoleOutput.println(F(" can't be used in an alias."));
+        return;
+      }
+
+      body[bodyLength++] = commandIndex;
+
+      for (; parameters && *parameters != '\0' && bodyLength < INPUT_BUFFER_SIZE; parameters++) { // (a body is never longer than the line it came from, plus its last 0)
+        body[bodyLength++] = *parameters == delimiter ? ALIAS_DELIMITER : *parameters;
+      }
+
+      body[bodyLength++] = '\0';
+    }
+
+    text = next;
+  }
+
+  int nameLength = strlen(name);
+  int used = aliasBytesUsed();
+  if (used < 0) used = 0; // (start again, dropping the aliases made for other commands)
+
+  if (bodyLength == 0) {
+    consoleOutput.println(F("Give the commands for the alias."));
+    return;
+  }
+
+  if (nameLength > 255 || bodyLength > 255) { // (the lengths are stored in a byte each)
+    consoleOutput.println(F("The name or the commands are too long for an alias."));
+    return;
+  }
+
+  if (ALIAS_HEADER_SIZE + used + 2 + nameLength + bodyLength > ALIAS_EEPROM_SIZE) {
+    consoleOutput.println(F("There isn't room for the alias. Delete some, or change ALIAS_EEPROM_SIZE."));
+    return;
+  }
+
+  uint8_t lengths[2] = {(uint8_t)nameLength,(uint8_t)bodyLength};
+  int address = ALIAS_RECORDS + used;
+
+  writeEepromBytes(address,lengths,2);
+  writeEepromBytes(address+2,(const uint8_t*)name,nameLength);
+  writeEepromBytes(address+2+nameLength,body,bodyLength);
+  setAliasBytesUsed(used + 2 + nameLength + bodyLength);
+
+  consoleOutput.print(F("Added "));
+  consoleOutput.print(2 + nameLength + bodyLength);
+  consoleOutput.print(F(" bytes to alias "));
+  consoleOutput.println(name);
+}
+
+
+// lists the aliases; given a name and commands, adds them to the alias (making it if it's new), or with delete, deletes it
+// one command can be given as it is (@alias,name,@put,gain,1.5), several need quotes (@alias,name,"@put,gain,1.5;@commit")
+void aliasCommand(CommandArgs &args) {
+
+  if (args.count == 0) {
+    startListing(&printAliasLine);
+    return;
+  }
+
+  const char* name = args.values[0];
+
+  if (findCommandIndex(name) != commandCount()) {
+    consoleOutput.print(name);
+    consoleOutput.println(F(" is a command, so it can't be an alias."));
+    return;
+  }
+
+  if (args.count == 1) {
+    consoleOutput.println(F("Give the commands to add to the alias (in quotes if there are several), or delete."));
+    return;
+  }
+
+  if (args.count == 2 && strcmp(args.values[1],"delete") == 0) {
+    consoleOutput.print(deleteAlias(name) > 0 ? F("Deleted alias ") : F("There is no alias "));
+    consoleOutput.println(name);
+    return;
+  }
+
+  // put the command's parameters back together
+  char delimiter = consoleOutput.console ? consoleOutput.console->delimiter : DELIMITER[0];
+  char commands[INPUT_BUFFER_SIZE+1];
+  TextBuffer text(commands,INPUT_BUFFER_SIZE);
+
+  for (int i = 1; i < args.count; i++) {
+    if (i > 1) text.print(delimiter);
+    text.print(args.values[i]);
+  }
+  commands[text.length] = '\0';
+
+  addAlias(name,commands,delimiter);
+}
+#endif
+
+
+// reads a variable from eeprom memory
+// uses one parameter, the variable name
+void getVariable(CommandArgs &args) {
+  //SERIAL_INTERFACE.println("get function is under construction. come back later.");
+
+  int variableIndex = findAndCheckVariableIndex(args.values[0]);
+
+  if (variableIndex == variableNum) return;
+
+  consoleOutput.print(args.values[0]);
+  consoleOutput.print(F("\u2192"));
+
+  VariableValue value = readVariable(variableIndex);
+
+  switch (variables[variableIndex].type) {
+    case 0:
+      consoleOutput.println(value.asByte);
+      break;
+    case 1:
+      consoleOutput.println(value.asDouble,10);
+      break;
+    default:
+      consoleOutput.println(F("Invalid variable type! \n\r Check the 'variables' list definition in the code ASAP."));
+
+  //SERIAL_INTERFACE.print("address:");
+  //SERIAL_INTERFACE.println(storedAddresses[variableIndex]);
+  }
+}
+
+
+
+// writes a variable to the eeprom
+// uses two parameters, the variable name and the value to write
+void putVariable(CommandArgs &args) {
+  //SERIAL_INTERFACE.println("put function is under construction. come back later.");
+
+  int variableIndex = findAndCheckVariableIndex(args.values[0]);
+
+  if (variableIndex == variableNum) return;
+
+  #ifndef NO_PARAMETER_SPECS
+  // check the value the same way as a parameter with a spec
+  ParameterSpec spec = {variables[variableIndex].type == 0 ? PARAMETER_BYTE : PARAMETER_DOUBLE,false,ParameterBound(),ParameterBound(),NULL};
+  ParameterValue parsed;
+
+  if (variables[variableIndex].type < typeNum && !parseParameter(spec,false,args.values[1],parsed)) {
+    consoleOutput.print('\'');
+    consoleOutput.print(args.values[1]);
+    consoleOutput.print(F("' is not a "));
+    consoleOutput.print(typeNames[variables[variableIndex].type]);
+    consoleOutput.println(F(" value."));
+    return;
+  }
+  #endif
+
+  consoleOutput.print(args.values[0]);
+  consoleOutput.print(F("\u2190"));
+
+  VariableValue value;
+
+  switch (variables[variableIndex].type) {
+    case 0:
+      #ifndef NO_PARAMETER_SPECS
+      value.asByte = parsed.asByte;
+      #else
+      value.asByte = atoi(args.values[1]);
+      #endif
+      consoleOutput.println(value.asByte);
+      break;
+    case 1:
+      #ifndef NO_PARAMETER_SPECS
+      value.asDouble = parsed.asDouble;
+      #else
+      value.asDouble = atof(args.values[1]);
+      #endif
+      consoleOutput.println(value.asDouble,10);
       break;
-    
-    case BACKSPACE: // backspace on linux
+    default:
+      consoleOutput.println(F("Invalid variable type! \n\r Check the 'variables' list definition in the code ASAP."));
+      return;
+  }
 
-    case DELETE: // backspace in putty
+  writeVariable(variableIndex,value);
+}
 
-      //SERIAL_INTERFACE.println("huh?");
 
-      if (inputIndex > 0) {
-        if (inputIndex == inputEnds[historyIndex]) {
-          SERIAL_INTERFACE.print("\b \b");
 
-        } else {
-          SERIAL_INTERFACE.print('\b');
+// gives the position of a type in typeNames, for each C++ type a variable can have
+template <typename T> struct VariableType;
+template <> struct VariableType<uint8_t> { static const uint8_t index = 0; };
+template <> struct VariableType<double> { static const uint8_t index = 1; };
 
-          for (int i = inputIndex; i < inputEnds[historyIndex]; i++) {
-            inputBuffer[i-1] = inputBuffer[i];
-            SERIAL_INTERFACE.print(inputBuffer[i]);
-          }
-          //SERIAL_INTERFACE.print("HELLO");
-          SERIAL_INTERFACE.print(" \u001b[");
-          SERIAL_INTERFACE.print(inputEnds[historyIndex] - inputIndex + 1);
-          SERIAL_INTERFACE.print('D');
+uint8_t* valuePointer(VariableValue &value, uint8_t*) { return &value.asByte; }
+double* valuePointer(VariableValue &value, double*) { return &value.asDouble; }
 
-        }
 
-        inputEnds[historyIndex]--;
-        inputIndex--;
-      }
-      break;
+// handle for reading a variable from application code, made with consoleVar<type>("name")
+// the name is looked up once; after that a read is a single load from the RAM copy, and it always sees values set with @put
+template <typename T>
+class ConsoleVar {
+public:
+  ConsoleVar() : index(-1), value(valuePointer(missingVariable,(T*)NULL)) {} // reads 0 until a handle from consoleVar() is assigned
+  ConsoleVar(int variableIndex, T* value) : index(variableIndex), value(value) {}
 
-    default: // anything else
-      SERIAL_INTERFACE.print(inputChar);
-      inputEnds[historyIndex]++;
-      
-      if (inputIndex < inputEnds[historyIndex] - 1) {
-        //SERIAL_INTERFACE.println(inputIndex);
-        //SERIAL_INTERFACE.println("not last char");
-        for (int i = inputEnds[historyIndex]; i > inputIndex; i--) inputBuffer[i] = inputBuffer[i-1];
+  operator T() const { return *value; }
+  T get() const { return *value; }
 
-        for (int i = inputIndex+1; i < inputEnds[historyIndex]; i++) SERIAL_INTERFACE.print(inputBuffer[i]);
+  // stores a new value the same way @put does
+  void set(T newValue) {
+    if (index < 0) return;
 
-        SERIAL_INTERFACE.print("\u001b[");
-        SERIAL_INTERFACE.print(inputEnds[historyIndex] - inputIndex - 1);
-        SERIAL_INTERFACE.print('D');
-        //SERIAL_INTERFACE.println();
-        //SERIAL_INTERFACE.println(inputIndex);
+    VariableValue stored = variableValues[index];
+    *valuePointer(stored,(T*)NULL) = newValue;
+    writeVariable(index,stored);
+  }
 
-      }
-      
+  ConsoleVar &operator=(T newValue) { set(newValue); return *this; }
 
-      inputBuffer[inputIndex] = inputChar;
-      inputIndex ++;
-      
+  bool valid() const { return index >= 0; } // false if the variable doesn't exist or has a different type
 
-    }
+  // whether the value has changed since the last check (clears the same flag as variableModified() and takeChangedVariables())
+  bool changed() {
+    if (index < 0 || !getFlag(changedVariables,index)) return false;
+
+    setFlag(changedVariables,index,false);
+    return true;
   }
 
-  inputBuffer[inputEnds[historyIndex]] = '\0';
+  int index; // position in variables[], or -1
+
+private:
+  T* value;
+};
 
-  return exit;
+
+// finds a variable and makes a handle for reading it, e.g.
+// ConsoleVar<double> gain = consoleVar<double>("gain");
+// call after the variable is registered and the eeprom is started (the value is loaded here)
+template <typename T>
+ConsoleVar<T> consoleVar(const char* name) {
+  int variableIndex = findVariableIndex(name);
+
+  if (variableIndex == variableNum || variables[variableIndex].type != VariableType<T>::index) {
+    SERIAL_INTERFACE.print(F("consoleVar(): '"));
+    SERIAL_INTERFACE.print(name);
+    SERIAL_INTERFACE.println(F("' is not a variable of that type."));
+    return ConsoleVar<T>(-1,valuePointer(missingVariable,(T*)NULL));
+  }
+
+  readVariable(variableIndex);
+  return ConsoleVar<T>(variableIndex,valuePointer(variableValues[variableIndex],(T*)NULL));
 }
+#endif
 
 
-// puts parameters from the input buffer into a parameter array
-// returns true if there were enough parameters
-// otherwise returns false
-bool getParametersFromInput(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH], int &commandIndex) {
-  int parameterIndex = 0;
+// lines of the list of commands printed by @help (see startListing())
+bool printHelpLine(Print &output, int line) {
+  int count = commandCount();
 
-  for (; parameterIndex < commands[commandIndex].maxParameters; parameterIndex++) {
-    
-    getToken(parameters[parameterIndex], inputBuffer, parameterIndex+1);
-    
+  if (line == 0) {
+    output.println(F("Available commands: "));
 
-    if (parameters[parameterIndex][0] == '\0' && parameterIndex < commands[commandIndex].minParameters) {
-      SERIAL_INTERFACE.println("Too few parameters!");
-      SERIAL_INTERFACE.print("Correct format: ");
-      SERIAL_INTERFACE.println(commands[commandIndex].use);
-      //SERIAL_INTERFACE.println(commands[commandIndex].minParameters);
-      
-      return false;
+  } else if (line <= count) {
+    Command command = getCommand(line-1);
+    printCommandString(output,command.name,command.flashStrings);
+    output.println();
+
+  } else if (line == count+1) {
+    output.println(F("\nFor additional information on a given command, type '@help"DELIMITER"<command>'"));
+  } else if (line == count+2) {
+    output.println(F("For help using the console, type '@controls'"));
+  } else if (line == count+3) {
+    output.println(F("command usage format: [] = required, () = optional, <> = non-literal, {} = default"));
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+
+// prints help on commands
+// if given no parameters, will print a list of possible commands
+// given a command as a parameter, it will tell what the command does and its parameter format
+void printCommandHelp(CommandArgs &args) {
+  //SERIAL_INTERFACE.println("help function is under construction. come back later.");
+
+  if (args.count == 0) {
+    startListing(&printHelpLine);
+
+  } else {
+    //SERIAL_INTERFACE.println("found parameter:");
+    //SERIAL_INTERFACE.println(parameters[0]);
+    //SERIAL_INTERFACE.println(parameters[1]);
+    int commandIndex = findAndCheckCommandIndex(args.values[0]);
+
+    if (commandIndex != commandCount()) {
+      Command command = getCommand(commandIndex);
+
+      consoleOutput.print(F("Name: "));
+      printCommandString(consoleOutput,command.name,command.flashStrings);
+      consoleOutput.print(F("\r\nDescription: "));
+      printCommandString(consoleOutput,command.description,command.flashStrings);
+      consoleOutput.print(F("\r\nUse: "));
+      printCommandString(consoleOutput,command.use,command.flashStrings);
+      consoleOutput.println();
     }
+    
+  }
+
+}
+
+
+#ifndef NO_EEPROM
+// lines of the list of eeprom variables printed by @variables (see startListing())
+bool printVariableLine(Print &output, int line) {
+
+  if (line == 0) {
+    output.println(F("EEPROM Variables: "));
+    return true;
+  }
+
+  int variableIndex = line-1;
+  if (variableIndex >= variableNum) return false;
+
+  output.print(variables[variableIndex].name);
+  output.print(F(" ("));
+  output.print(typeNames[variables[variableIndex].type]);
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  if (getFlag(pendingVariables,variableIndex)) {
+    output.println(F(") - Not committed "));
+    return true;
+  }
+  #endif
+
+  if (getFlag(changedVariables,variableIndex)) {
+    output.println(F(") - Modified "));
+  } else {
+    output.println(')');
   }
 
   return true;
 }
 
 
+// prints the name and type of every eeprom variable
+void printVariables(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  startListing(&printVariableLine);
+}
+#endif
+
+
+
+// lines of the console controls printed by @controls (see startListing())
+bool printControlsLine(Print &output, int line) {
+  int number = 0; // (lines are numbered as they go, as some depend on the configuration)
+
+  if (line == number++) output.println(F("Console Controls:"));
+  else if (line == number++) output.println(F("Press Escape to exit console mode"));
+  else if (line == number++) output.println(F("Press the up or down arrows to move in the command history"));
+  else if (line == number++) output.println(F("Left, right, home, end, backspace, and delete are all supported when entering commands"));
+  else if (line == number++) output.println(F("Hold ctrl or alt with left or right to move by words"));
+  #ifndef NO_TAB_COMPLETION
+  else if (line == number++) output.println(F("Press tab to complete command and variable names, twice to list them"));
+  #endif
+  else if (line == number++) output.println(F("Separate commands with ; to run several from one line"));
+  #ifdef USE_CONSOLE_JOBS
+  else if (line == number++) output.println(F("Press ctrl-c to cancel the running job, or stop a listing (or discard the line being entered)"));
+  #else
+  else if (line == number++) output.println(F("Press ctrl-c to stop a listing (or discard the line being entered)"));
+  #endif
+  else return false;
+
+  return true;
+}
+
+
+// prints the available controls to help users understand how to navigate/use the console
+void printControls(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  startListing(&printControlsLine);
+}
 
 
-// starts once incoming serial data is detected
-// press escape to exit
-// executes commands incoming on the serial port
-void runSerialCommands() {
-  if (!SERIAL_INTERFACE.available()) {
+#ifdef USE_CONSOLE_JOBS
+// prints a line about a running job for @jobs
+void printJobLine(int slot) {
+  printJobName(slot);
+  consoleOutput.print(jobs[slot].foreground ? F(" foreground, ") : F(" background, "));
+  consoleOutput.print(millis() - jobs[slot].startMs);
+  consoleOutput.print(F(" ms, "));
+  consoleOutput.print(jobs[slot].steps);
+  consoleOutput.print(F(" steps, busy "));
+  consoleOutput.print(jobs[slot].busyMicros / 1000);
+  consoleOutput.print(F(" ms"));
+  if ((long)(millis() - jobs[slot].wakeMs) < 0) consoleOutput.print(F(", sleeping"));
+  consoleOutput.println();
+}
+
+
+// lists the running jobs, or with a job number, that job; adding "cancel" or "bg" cancels it or moves it to the background (where ctrl-c doesn't reach it)
+void jobsCommand(CommandArgs &args) {
+
+  if (args.count > 0) {
+    #ifndef NO_PARAMETER_SPECS
+    int slot = args.parsed[0].asInt - 1;
+    int action = args.count > 1 ? args.parsed[1].asChoice : -1; // position in "cancel|bg"
+    #else
+    int slot = atoi(args.values[0]) - 1;
+    int action = strcmp(args.values[1],"cancel") == 0 ? 0 : strcmp(args.values[1],"bg") == 0 ? 1 : -1;
+
+    if (args.count > 1 && action < 0) {
+      consoleOutput.println(F("Give cancel or bg after the job number."));
+      return;
+    }
+    #endif
+
+    if (slot < 0 || slot >= MAX_JOBS || !jobs[slot].running) {
+      consoleOutput.print(F("There is no job "));
+      consoleOutput.println(args.values[0]);
+      return;
+    }
+
+    if (action == 0) jobs[slot].cancelled = true;
+    else if (action == 1) jobs[slot].foreground = false;
+    else printJobLine(slot);
     return;
   }
-  bool exit = false;
-  int historyIndex = 0;
 
-  
-  // keep in console mode until exited
-  while (!exit) {
+  bool any = false;
+
+  for (int slot = 0; slot < MAX_JOBS; slot++) {
+    if (!jobs[slot].running) continue;
+    any = true;
+    printJobLine(slot);
+  }
+
+  if (!any) consoleOutput.println(F("No jobs running"));
+}
+#endif
+
 
-    SERIAL_INTERFACE.print(ENTRY_PREFIX);
+#ifdef USE_CONSOLE_STATS
+// prints the statistics of each command which has run, and of the console as a whole
+// uses one optional parameter, reset, which clears them
+void statsCommand(CommandArgs &args) {
+
+  if (strcmp(args.values[0],"reset") == 0) {
+    resetStats();
+    consoleOutput.println(F("Statistics reset"));
+    return;
+  }
 
-    exit = getSerialInput(historyIndex,true); // have the user enter a string
+  for (int commandIndex = 0; commandIndex < commandCount(); commandIndex++) {
+    CommandStats* stats = findCommandStats(commandIndex);
+    if (!stats || (stats->calls == 0 && stats->parseFailures == 0)) continue;
+
+    Command command = getCommand(commandIndex);
+    printCommandString(consoleOutput,command.name,command.flashStrings);
+    consoleOutput.print(F(": "));
+    consoleOutput.print(stats->calls);
+    consoleOutput.print(F(" calls, "));
+    consoleOutput.print(stats->minMicros);
+    consoleOutput.print('/');
+    consoleOutput.print(stats->calls ? stats->totalMicros / stats->calls : 0);
+    consoleOutput.print('/');
+    consoleOutput.print(stats->maxMicros);
+    consoleOutput.print(F(" us (min/mean/max), "));
+    consoleOutput.print(stats->bytesWritten);
+    consoleOutput.print(F(" bytes written, "));
+    consoleOutput.print(stats->parseFailures);
+    consoleOutput.println(F(" parse failures"));
+  }
 
-    SERIAL_INTERFACE.println();
+  unsigned long totalMs = millis() - consoleStats.sinceMs;
+
+  consoleOutput.print(F("keystrokes: "));
+  consoleOutput.print(consoleStats.keystrokes);
+  consoleOutput.print(F(", unknown commands: "));
+  consoleOutput.println(consoleStats.unknownCommands);
+  consoleOutput.print(F("line redraws: "));
+  consoleOutput.print(consoleStats.redraws);
+  consoleOutput.print(F(", "));
+  consoleOutput.print(consoleStats.redrawBytes);
+  consoleOutput.println(F(" bytes"));
+  consoleOutput.print(F("console time: "));
+  consoleOutput.print(consoleStats.consoleTime.ms);
+  consoleOutput.print(F(" ms, application time: "));
+  consoleOutput.print(totalMs - consoleStats.consoleTime.ms);
+  consoleOutput.println(F(" ms"));
+  consoleOutput.print(F("this console: active "));
+  consoleOutput.print(consoleOutput.console->activeTime.ms);
+  consoleOutput.print(F(" ms, idle in a session "));
+  consoleOutput.print(consoleOutput.console->idleTime.ms);
+  consoleOutput.println(F(" ms"));
+}
+#endif
 
-    // skip command handling if exit trigged
-    if (exit) continue;
 
 
-    // identify the command being executed
-    char command[MAX_PARAMETER_LENGTH];
-    getToken(command, inputBuffer,0);
+#ifdef USE_BINARY_PROTOCOL
+/* -- -- -- -- -- -- Binary protocol -- -- -- -- -- -- */
 
+// frames (both directions): BINARY_FRAME_START, payload length, payload, CRC-16/CCITT of the length and payload (low byte first)
+//
+// request payload: sequence number, then one or more operations, run in order:
+//   BINARY_CALL   command index, argument count, typed arguments -> status, string (everything the command printed)
+//   BINARY_GET    variable index                                   -> status, typed value
+//   BINARY_PUT    variable index, typed value                      -> status
+//   BINARY_INFO                                                    -> status, command count, variable count
+//   BINARY_NAME   0 (command) or 1 (variable), index               -> status, string
+//   BINARY_EXIT                                                    -> status (the session ends after the response)
+// response payload: the request's sequence number, the frame status, then the result of each operation
+// if an operation is malformed its status is BINARY_BAD_REQUEST and the rest of the request is skipped
+//
+// typed values are a type byte followed by the value, multi-byte values little endian:
+//   BINARY_BYTE 1 byte, BINARY_INT 4 byte signed integer, BINARY_FLOAT 4 byte IEEE float (doubles are sent as floats),
+//   BINARY_STRING length byte followed by the characters
+//
+// commands run in binary mode should print through consoleOutput, so their output ends up in the response
+
+  enum BinaryOperation : uint8_t {
+    BINARY_CALL = 1,
+    BINARY_GET = 2,
+    BINARY_PUT = 3,
+    BINARY_INFO = 4,
+    BINARY_NAME = 5,
+    BINARY_EXIT = 0x7F
+  };
 
-    int commandIndex = findAndCheckCommandIndex(command);
+  enum BinaryType : uint8_t {
+    BINARY_BYTE = 0,
+    BINARY_FLOAT = 1,
+    BINARY_INT = 2,
+    BINARY_STRING = 3
+  };
 
-    // get ready to execute command if valid
-    if (commandIndex != commandNum) {
+  enum BinaryStatus : uint8_t {
+    BINARY_OK = 0,
+    BINARY_BAD_CRC = 1, // frame status only; no operations were run
+    BINARY_BAD_REQUEST = 2, // operation cut short or containing an unknown type
+    BINARY_UNKNOWN_OPERATION = 3,
+    BINARY_BAD_INDEX = 4, // no command or variable with that index
+    BINARY_WRONG_TYPE = 5, // value can't be stored in the variable
+    BINARY_TOO_FEW_ARGUMENTS = 6,
+    BINARY_RESPONSE_FULL = 7, // the result didn't fit in the response; the rest of the request is skipped
+    BINARY_BAD_ARGUMENT = 8 // an argument doesn't fit the command's parameter spec
+  };
 
-      char parameters[MAX_PARAMETERS][MAX_PARAMETER_LENGTH];
 
-      
-      incrementBufferHistory(historyIndex); // shift history positions
+// reads through a request payload, noting when it runs past the end
+struct BinaryReader {
+  const uint8_t* data;
+  int length;
+  int position;
+  bool failed;
+
+  bool has(int count) {
+    if (position + count > length) failed = true;
+    return !failed;
+  }
+
+  uint8_t readByte() {
+    return has(1) ? data[position++] : 0;
+  }
+
+  void readBytes(void* value, int count) {
+    if (!has(count)) return;
+    memcpy(value,data+position,count);
+    position += count;
+  }
+};
+
+
+// builds a response payload, noting when it runs out of room
+struct BinaryWriter {
+  uint8_t data[BINARY_FRAME_SIZE];
+  int length;
+  bool full;
+
+  bool has(int count) {
+    if (length + count > BINARY_FRAME_SIZE) full = true;
+    return !full;
+  }
+
+  void writeByte(uint8_t value) {
+    if (has(1)) data[length++] = value;
+  }
+
+  void writeBytes(const void* value, int count) {
+    if (!has(count)) return;
+    memcpy(data+length,value,count);
+    length += count;
+  }
+
+  void writeString(const char* text, bool inFlash = false) {
+    int textLength = min((int)(inFlash ? strlen_P(text) : strlen(text)),255);
+    writeByte(textLength);
+
+    if (!has(textLength)) return;
+    if (inFlash) memcpy_P(data+length,text,textLength);
+    else memcpy(data+length,text,textLength);
+    length += textLength;
+  }
+};
+
+
+// reads a typed value as a number (strings can't be read this way)
+bool readBinaryNumber(BinaryReader &request, uint8_t type, double &value) {
+  switch (type) {
+    case BINARY_BYTE:
+      value = request.readByte();
+      return true;
+    case BINARY_FLOAT: {
+      float number = 0;
+      request.readBytes(&number,sizeof(number));
+      value = number;
+      return true;
+    }
+    case BINARY_INT: {
+      int32_t number = 0;
+      request.readBytes(&number,sizeof(number));
+      value = number;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+// runs a command; the arguments are turned into the text the command would have been given on the terminal
+BinaryStatus binaryCall(BinaryReader &request, BinaryWriter &response) {
+
+  int commandIndex = request.readByte();
+  int argumentNum = request.readByte();
+
+  char text[BINARY_FRAME_SIZE + MAX_PARAMETERS*16]; // the arguments as strings, one after another
+  TextBuffer argumentText(text,sizeof(text)-1);
+
+  CommandArgs args;
+  args.count = 0;
+
+  for (int i = 0; i < argumentNum && !request.failed; i++) {
+    uint8_t type = request.readByte();
+    int start = argumentText.length;
+
+    if (type == BINARY_STRING) {
+      int length = request.readByte();
+      if (request.has(length)) argumentText.write(request.data+request.position,length);
+      request.position += length;
 
-      // run command
-      if (getParametersFromInput(parameters,commandIndex)) {
-        commands[commandIndex].function(parameters);
-      }
     } else {
-      incrementBufferHistory(historyIndex); // shift history positions
+      double value;
+      if (!readBinaryNumber(request,type,value)) return BINARY_BAD_REQUEST;
 
+      if (type == BINARY_FLOAT) argumentText.print(value,6);
+      else argumentText.print((long)value);
     }
-    
 
-    historyIndex = 0;
+    argumentText.write((uint8_t)'\0');
+
+    if (i < MAX_PARAMETERS) {
+      args.values[i] = text+start;
+      args.lengths[i] = argumentText.length-start-1;
+      args.count++;
+    }
+  }
+
+  if (request.failed || argumentText.truncated) return BINARY_BAD_REQUEST;
+  if (commandIndex >= commandCount()) return BINARY_BAD_INDEX;
+
+  Command command = getCommand(commandIndex);
+
+  args.count = min((int)args.count,(int)command.maxParameters);
+  for (int i = args.count; i < MAX_PARAMETERS; i++) {
+    args.values[i] = (char*)"";
+    args.lengths[i] = 0;
+  }
+
+  if (args.count < command.minParameters) {
+    #ifdef USE_CONSOLE_STATS
+    recordParseFailure(commandIndex);
+    #endif
+    return BINARY_TOO_FEW_ARGUMENTS;
+  }
+
+  #ifndef NO_PARAMETER_SPECS
+  if (command.parameterSpecs && parseParameters(args,command) >= 0) {
+    #ifdef USE_CONSOLE_STATS
+    recordParseFailure(commandIndex);
+    #endif
+    return BINARY_BAD_ARGUMENT;
   }
+  #endif
+
+
+  // capture the command's output into the response, after the status and length bytes
+  if (!response.has(2)) return BINARY_RESPONSE_FULL;
+
+  TextBuffer output((char*)response.data+response.length+2,min(BINARY_FRAME_SIZE-response.length-2,255));
+
+  consoleOutput.flush();
+  consoleOutput.redirect = &output;
+  callCommand(commandIndex,command,args);
+  consoleOutput.redirect = NULL;
+
+  response.writeByte(BINARY_OK);
+  response.writeByte(output.length);
+  response.length += output.length;
+  return BINARY_OK;
 }
 
 
 #ifndef NO_EEPROM
+// sends a variable's value
+BinaryStatus binaryGet(BinaryReader &request, BinaryWriter &response) {
+  int variableIndex = request.readByte();
 
+  if (request.failed) return BINARY_BAD_REQUEST;
+  if (variableIndex >= variableNum) return BINARY_BAD_INDEX;
+  if (!response.has(6)) return BINARY_RESPONSE_FULL;
 
-// checks if a variable at a given address has been changed
-// if clearFlag is set, it will also set the modified flag to false afterwards
-bool variableModified(int address, bool clearFlag = false) {
-  int variableIndex = 0;
-  for(; variableIndex < variableNum && variables[variableIndex].address != address; variableIndex++);
-  
-  if (variableIndex == variableNum) {
-    //SERIAL_INTERFACE.println("isVariableModified() being called on nonexistant variable!");
-    return false;
+  VariableValue value = readVariable(variableIndex);
+
+  response.writeByte(BINARY_OK);
+
+  if (variables[variableIndex].type == 0) {
+    response.writeByte(BINARY_BYTE);
+    response.writeByte(value.asByte);
+  } else {
+    float number = value.asDouble;
+    response.writeByte(BINARY_FLOAT);
+    response.writeBytes(&number,sizeof(number));
   }
 
-  bool modified = variables[variableIndex].modified;
+  return BINARY_OK;
+}
 
-  if (clearFlag) variables[variableIndex].modified = false;
 
-  return modified;
+// stores a variable's value the same way @put does
+BinaryStatus binaryPut(BinaryReader &request, BinaryWriter &response) {
+  int variableIndex = request.readByte();
+  uint8_t type = request.readByte();
+
+  double number;
+  if (!readBinaryNumber(request,type,number) || request.failed) return BINARY_BAD_REQUEST;
+  if (variableIndex >= variableNum) return BINARY_BAD_INDEX;
+
+  VariableValue value;
+
+  if (variables[variableIndex].type == 0) {
+    if (type == BINARY_FLOAT || number < 0 || number > 255) return BINARY_WRONG_TYPE;
+    value.asByte = number;
+  } else {
+    value.asDouble = number;
+  }
+
+  writeVariable(variableIndex,value);
+  return BINARY_OK;
 }
+#endif
 
 
-// reads a variable from eeprom memory
-// uses one parameter, the variable name
-void getVariable(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
-  //SERIAL_INTERFACE.println("get function is under construction. come back later.");
+// runs one operation of a request, writing its result to the response
+// returns false if the rest of the request should be skipped
+bool runBinaryOperation(BinaryReader &request, BinaryWriter &response) {
 
-  int variableIndex = findAndCheckVariableIndex(parameters[0]);
+  int start = response.length;
+  BinaryStatus status;
 
-  if (variableIndex == variableNum) return;
+  switch (request.readByte()) {
+    case BINARY_CALL:
+      status = binaryCall(request,response);
+      break;
 
-  SERIAL_INTERFACE.print(parameters[0]);
-  SERIAL_INTERFACE.print("\u2192");
+    #ifndef NO_EEPROM
+    case BINARY_GET:
+      status = binaryGet(request,response);
+      break;
+    case BINARY_PUT:
+      status = binaryPut(request,response);
+      if (status == BINARY_OK) response.writeByte(BINARY_OK);
+      break;
+    #endif
 
-  switch (variables[variableIndex].type) {
-    case 0:
-      uint8_t byte;
-      eepromGet(variables[variableIndex].address,byte);
-      SERIAL_INTERFACE.println(byte);
+    case BINARY_INFO:
+      status = BINARY_OK;
+      response.writeByte(BINARY_OK);
+      response.writeByte(commandCount());
+      #ifndef NO_EEPROM
+      response.writeByte(variableNum);
+      #else
+      response.writeByte(0);
+      #endif
       break;
-    case 1:
-      double decimal;
-      eepromGet(variables[variableIndex].address,decimal);
-      SERIAL_INTERFACE.println(decimal,10);
+
+    case BINARY_NAME: {
+      uint8_t kind = request.readByte();
+      int index = request.readByte();
+
+      status = BINARY_OK;
+      if (request.failed) status = BINARY_BAD_REQUEST;
+      else if (kind == 0 && index < commandCount()) {
+        response.writeByte(BINARY_OK);
+        Command command = getCommand(index);
+        response.writeString(command.name,command.flashStrings);
+      }
+      #ifndef NO_EEPROM
+      else if (kind == 1 && index < variableNum) {
+        response.writeByte(BINARY_OK);
+        response.writeString(variables[index].name);
+      }
+      #endif
+      else status = BINARY_BAD_INDEX;
+      break;
+    }
+
+    case BINARY_EXIT:
+      status = BINARY_OK;
+      response.writeByte(BINARY_OK);
+      binaryExit = true;
       break;
+
     default:
-      SERIAL_INTERFACE.println("Invalid variable type! \n\r Check the 'variables' list definition in the code ASAP.");
+      status = BINARY_UNKNOWN_OPERATION;
+  }
 
-  //SERIAL_INTERFACE.print("address:");
-  //SERIAL_INTERFACE.println(storedAddresses[variableIndex]);
+  if (request.failed) status = BINARY_BAD_REQUEST;
+  if (response.full) status = BINARY_RESPONSE_FULL;
+
+  // failed operations only answer with their status
+  if (status != BINARY_OK) {
+    response.length = start;
+    response.full = false;
+    response.writeByte(status);
   }
+
+  return status != BINARY_BAD_REQUEST && status != BINARY_UNKNOWN_OPERATION && status != BINARY_RESPONSE_FULL;
 }
 
 
+// sends a frame with the given payload
+void sendBinaryFrame(const uint8_t* payload, int length) {
+  uint8_t lengthByte = length;
+  uint16_t crc = crc16(payload,length,crc16(&lengthByte,1));
 
-// writes a variable to the eeprom
-// uses two parameters, the variable name and the value to write
-void putVariable(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
-  //SERIAL_INTERFACE.println("put function is under construction. come back later.");
+  consoleOutput.write((uint8_t)BINARY_FRAME_START);
+  consoleOutput.write(lengthByte);
+  consoleOutput.write(payload,length);
+  consoleOutput.write((uint8_t)(crc & 0xFF));
+  consoleOutput.write((uint8_t)(crc >> 8));
+}
 
-  int variableIndex = findAndCheckVariableIndex(parameters[0]);
 
-  if (variableIndex == variableNum) return;
+// answers a complete frame (the answer goes through consoleOutput)
+void runBinaryFrame(uint8_t* frame) {
+  int length = frame[1];
+  uint8_t* payload = frame+2;
 
-  SERIAL_INTERFACE.print(parameters[0]);
-  SERIAL_INTERFACE.print("\u2190");
+  uint16_t crc = payload[length] | (payload[length+1] << 8);
 
+  BinaryReader request = {payload,length,0,false};
+  BinaryWriter response;
+  response.length = 0;
+  response.full = false;
 
-  switch (variables[variableIndex].type) {
-    case 0:
-      uint8_t byte;
-      byte = atoi(parameters[1]);
-      eepromPut(variables[variableIndex].address,byte);
-      SERIAL_INTERFACE.println(byte);
-      break;
-    case 1:
-      double decimal;
-      decimal = atof(parameters[1]);
-      eepromPut(variables[variableIndex].address,decimal);
-      SERIAL_INTERFACE.println(decimal,10);
-      break;
-    default:
-      SERIAL_INTERFACE.println("Invalid variable type! \n\r Check the 'variables' list definition in the code ASAP.");
+  response.writeByte(request.readByte()); // sequence number
+
+  if (crc != crc16(frame+1,length+1)) {
+    binaryStats.badFrames++;
+    response.writeByte(BINARY_BAD_CRC);
+
+  } else {
+    response.writeByte(BINARY_OK);
+    while (request.position < request.length && runBinaryOperation(request,response));
   }
 
-  variables[variableIndex].modified = true;
+  binaryStats.frames++;
+  sendBinaryFrame(response.data,response.length);
 }
-#endif
 
 
-// prints help on commands
-// if given no parameters, will print a list of possible commands
-// given a command as a parameter, it will tell what the command does and its parameter format
-void printCommandHelp(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
-  //SERIAL_INTERFACE.println("help function is under construction. come back later.");
+// takes in binary protocol input while the session is in binary mode (see advanceConsole())
+// answers at most one frame per call
+template <typename StreamType, typename Config>
+bool ConsoleControl<StreamType,Config>::advanceBinary() {
+
+  for (int i = 0; i < CONSOLE_POLL_MAX_BYTES && rxAvailable(); i++) {
+
+    uint8_t inputByte = rxRead();
+    lastInputMs = millis();
+    binaryByteMs = lastInputMs;
 
-  if (parameters[0][0] == NULL) {
-    SERIAL_INTERFACE.println("Available commands: ");
+    if (binaryLength == 0 && inputByte != BINARY_FRAME_START) { // not the start of a frame
+      binaryStats.droppedBytes++;
+      continue;
+    }
 
-    for (int i = 0; i < commandNum; i++) {
-      SERIAL_INTERFACE.println(commands[i].name);
+    if (binaryLength == 1 && inputByte > BINARY_FRAME_SIZE) { // too long to be a frame
+      binaryStats.droppedBytes += 2;
+      binaryLength = 0;
+      continue;
     }
 
-    SERIAL_INTERFACE.println("\nFor additional information on a given command, type '@help"DELIMITER"<command>'");
-    SERIAL_INTERFACE.println("For help using the console, type '@controls'");
-    SERIAL_INTERFACE.println("command usage format: [] = required, () = optional, <> = non-literal, {} = default");
+    binaryFrame[binaryLength++] = inputByte;
 
-  } else {
-    //SERIAL_INTERFACE.println("found parameter:");
-    //SERIAL_INTERFACE.println(parameters[0]);
-    //SERIAL_INTERFACE.println(parameters[1]);
-    int commandIndex = findAndCheckCommandIndex(parameters[0]);
+    if (binaryLength >= 2 && binaryLength == binaryFrame[1]+4) {
+      binaryLength = 0;
+
+      ConsoleBase* previousConsole = consoleOutput.use(this);
+      runBinaryFrame(binaryFrame);
+      consoleOutput.use(previousConsole);
+
+      if (binaryExit) { // the request ended the session
+        binaryExit = false;
+        endConsoleSession();
+        return false;
+      }
 
-    if (commandIndex != commandNum) {
-      SERIAL_INTERFACE.print("Name: ");
-      SERIAL_INTERFACE.println(commands[commandIndex].name);
-      SERIAL_INTERFACE.print("Description: ");
-      SERIAL_INTERFACE.println(commands[commandIndex].description);
-      SERIAL_INTERFACE.print("Use: ");
-      SERIAL_INTERFACE.println(commands[commandIndex].use);
+      return true;
     }
-    
   }
 
-}
 
+  unsigned long now = millis();
 
-#ifndef NO_EEPROM
-// prints the name and type of every eeprom variable
-void printVariables(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  if (binaryLength > 0 && now - binaryByteMs >= BINARY_BYTE_TIMEOUT_MS) {
+    binaryStats.droppedBytes += binaryLength;
+    binaryLength = 0;
+  }
+
+  if (now - lastInputMs >= CONSOLE_CONTROL_TIMEOUT_MS) {
+    endConsoleSession();
+    return false;
+  }
 
-  SERIAL_INTERFACE.println("EEPROM Variables: ");
+  return true;
+}
 
-  for (int variableIndex = 0; variableIndex < variableNum; variableIndex++) {
 
-    SERIAL_INTERFACE.print(variables[variableIndex].name);
-    SERIAL_INTERFACE.print(" (");
-    SERIAL_INTERFACE.print(typeNames[variables[variableIndex].type]);
-    
-    if (variables[variableIndex].modified) {
-      SERIAL_INTERFACE.println(") - Modified ");
-    } else {
-      SERIAL_INTERFACE.println(')');
-    }
-  }
+// switches the session to the binary protocol
+template <typename StreamType, typename Config>
+void ConsoleControl<StreamType,Config>::startBinary() {
+  binaryMode = true;
+  binaryLength = 0;
+}
+
+
+// switches the console running it to the binary protocol
+void binaryCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+  consoleOutput.console->startBinary();
 }
 #endif
 
 
 
-// prints the available controls to help users understand how to navigate/use the console
-void printControls(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
+#ifdef CONSOLE_RAM_BUDGET
+static_assert(consoleRamTotal <= CONSOLE_RAM_BUDGET, "ConsoleControl uses more static RAM than CONSOLE_RAM_BUDGET (define CONSOLE_RAM_REPORT to see where it goes)");
+#endif
 
-  SERIAL_INTERFACE.println("Console Controls:");
-  SERIAL_INTERFACE.println("Press Escape to exit console mode");
-  SERIAL_INTERFACE.println("Press the up or down arrows to move in the command history");
-  SERIAL_INTERFACE.println("Left, right, and backspace are all supported when entering commands");
-}
+#ifdef CONSOLE_RAM_REPORT
+// using this function makes the compiler warn with its template arguments, which are the byte counts
+template <unsigned int total, unsigned int commands, unsigned int console, unsigned int variables>
+__attribute__((deprecated("ConsoleControl static RAM report (bytes)"))) constexpr int consoleRamReport() { return 0; }
+
+static const int consoleRamReported = consoleRamReport<consoleRamTotal,consoleRamCommands,consoleRamConsole,consoleRamVariables>();
+#endif
 
 
 // end of header
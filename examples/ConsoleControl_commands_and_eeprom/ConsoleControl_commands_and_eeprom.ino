@@ -37,6 +37,11 @@
 
 
 
+ConsoleVar<double> test1Value; // handle for reading the "test1" variable (set up in setup())
+
+
+
+
 /* functions to be run by commands (must be declared before they are registered as commands with registerCommand()) */
 
 // declare the function which will be run by command "test1"
@@ -72,6 +77,20 @@ void otherTest(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {
 }
 
 
+// declare the function which will be run by command "test3"
+// its parameters are checked and converted before it runs, as described by the specs below, so it can use them right away
+void checkedTest(CommandArgs &args) {
+
+  Serial1.print("Test3 = Success! Count: ");
+  Serial1.print(args.parsed[0].asInt);
+
+  Serial1.print(", mode: ");
+  Serial1.println(args.parsed[1].asChoice == 0 ? "on" : "off");
+}
+
+const ParameterSpec checkedTestParameters[] = {INT_PARAMETER(1,10),CHOICE_PARAMETER("on|off")}; // a whole number from 1 to 10, then on or off
+
+
 
 
 
@@ -98,6 +117,7 @@ void setup() {
   // add custom commands
   registerCommand({"@test1","testing adding commands","@test1",0,0,&test1}); // register a command
   registerCommand({"@test2","testing adding commands","@test2,[<anything>],(<#.##>)",2,1,&otherTest}); // register another command
+  registerCommand({"@test3","testing checked parameters","@test3,[<1-10>],[on/off]",0,2,NULL,&checkedTest},checkedTestParameters); // register a command with parameter specs (max parameters comes from the specs)
   /* 
    * command format: name (string), description (string), usage (string), maximum parameters (0-255), minimum parameters (0-255), &functionName
    * 
@@ -117,6 +137,8 @@ void setup() {
    * variable format: name (string), type (1=byte,2=double) (check library to be sure), address (integer, must be within eeprom size)
   */
 
+  test1Value = consoleVar<double>("test1"); // look the variable up once, so loop() can read it from RAM
+
 }
 
 
@@ -124,8 +146,14 @@ void setup() {
 void loop() {
 
 
-  // run this to check if the user is inputting anything;
-  // once it detects input, it will enter console mode until the user presses escape
-  // warning: will block other execution until exited by pressing escape
-  runSerialCommands(); 
+  // run this every loop to handle anything the user is inputting;
+  // it only handles characters which have already arrived and then returns, so the rest of loop() keeps running during a console session
+  // (runSerialCommands() can be used instead to block until the user presses escape)
+  consolePoll();
+
+
+  // reading a variable through its handle costs no eeprom access, and picks up values stored with @put right away
+  if (test1Value > 100) {
+    // ...
+  }
 }
\ No newline at end of file
@@ -22,6 +22,9 @@
   // This avoids atof() and atoi() which results in much smaller flash memory used if the functions
   // are not used elsewhere
   #define NO_EEPROM true 
+
+  // leave out parameter specs as well, which would bring in strtol() and strtod()
+  #define NO_PARAMETER_SPECS
 //
 
 
@@ -105,10 +108,10 @@ void setup() {
 // main loop
 void loop() {
 
-  // run this to check if the user is inputting anything;
-  // once it detects input, it will enter console mode until the user presses escape
-  // warning: will block other execution until exited by pressing escape
-  runSerialCommands();
+  // run this every loop to handle anything the user is inputting;
+  // it only handles characters which have already arrived and then returns, so the rest of loop() keeps running during a console session
+  // (runSerialCommands() can be used instead to block until the user presses escape)
+  consolePoll();
   
 
 }
\ No newline at end of file
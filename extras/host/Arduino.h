@@ -0,0 +1,266 @@
+/*
+ * Host-side stand-in for the parts of the Arduino core used by ONC_ConsoleControl.h
+ *
+ * Provides Print/Stream, a scripted in-memory serial port (MockStream),
+ * a virtual clock behind millis()/micros()/delay(), and the PROGMEM helpers,
+ * so the library can be compiled and measured on a regular Linux machine.
+ *
+ * The clock only moves when delay()/yield() are called or the host code advances it,
+ * which keeps timeouts and escape-sequence timing deterministic.
+*/
+
+
+#ifndef HOST_ARDUINO_h
+#define HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <deque>
+#include <string>
+
+
+/* -- -- -- -- -- -- Core types and helpers -- -- -- -- -- -- */
+
+  typedef uint8_t byte;
+  typedef bool boolean;
+
+  #define DEC 10
+  #define HEX 16
+  #define OCT 8
+  #define BIN 2
+
+  template <typename A, typename B>
+  auto max(const A &a, const B &b) -> decltype(a > b ? a : b) { return a > b ? a : b; }
+
+  template <typename A, typename B>
+  auto min(const A &a, const B &b) -> decltype(a < b ? a : b) { return a < b ? a : b; }
+
+
+  // flash strings live in ordinary memory on the host
+  class __FlashStringHelper;
+  #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+  #define PROGMEM
+  #define PSTR(string_literal) (string_literal)
+  #define PGM_P const char *
+  #define strcmp_P strcmp
+  #define strncmp_P strncmp
+  #define strlen_P strlen
+  #define memcpy_P memcpy
+  #define pgm_read_byte(address) (*(const uint8_t *)(address))
+  #define pgm_read_word(address) (*(const uint16_t *)(address))
+  #define pgm_read_ptr(address) (*(void * const *)(address))
+//
+
+
+
+
+/* -- -- -- -- -- -- Virtual clock -- -- -- -- -- -- */
+
+  unsigned long long mockMicros = 0; // current virtual time
+
+  // moves the virtual clock forward
+  void mockAdvanceMicros(unsigned long long us) { mockMicros += us; }
+
+  unsigned long millis() { return (unsigned long)(mockMicros / 1000); }
+  unsigned long micros() { return (unsigned long)mockMicros; }
+  void delay(unsigned long ms) { mockMicros += (unsigned long long)ms * 1000; }
+  void delayMicroseconds(unsigned int us) { mockMicros += us; }
+  void yield() { mockMicros += 10; } // stands in for the time a pass through a busy loop takes
+//
+
+
+
+
+/* -- -- -- -- -- -- Print / Stream -- -- -- -- -- -- */
+
+  // same public interface as the Arduino core's Print class
+  class Print {
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t value) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t n = 0;
+      while (size--) n += write(*buffer++);
+      return n;
+    }
+
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *str) { // one byte at a time, like the core does from flash
+      const char *text = (const char *)str;
+      size_t n = 0;
+      while (char c = pgm_read_byte(text++)) n += write((uint8_t)c);
+      return n;
+    }
+    size_t print(const char str[]) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC) {
+      if (base == DEC && n < 0) return print('-') + printNumber((unsigned long)(-n), DEC);
+      return printNumber((unsigned long)n, base);
+    }
+    size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+    size_t print(double n, int digits = 2) {
+      char text[48];
+      snprintf(text, sizeof(text), "%.*f", digits, n);
+      return write(text);
+    }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T &value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+
+  private:
+    size_t printNumber(unsigned long n, int base) {
+      char text[8 * sizeof(long) + 1];
+      char *cursor = &text[sizeof(text) - 1];
+      *cursor = '\0';
+      if (base < 2) base = 10;
+      do {
+        char digit = n % base;
+        n /= base;
+        *--cursor = digit < 10 ? digit + '0' : digit + 'A' - 10;
+      } while (n);
+      return write(cursor);
+    }
+  };
+
+
+  class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+  };
+
+
+  // serial port double: input is scripted by the host code, output is captured
+  // counts write() calls so batching of output can be measured (one call ~ one USB/UART transaction)
+  //
+  // it can also act like a UART at a given speed (see schedule() and txMicrosPerByte):
+  // scheduled bytes arrive at their time into a receive FIFO of rxFifoSize bytes and are dropped if it is full,
+  // and output drains at txMicrosPerByte from a txFifoSize byte buffer, with write() waiting (moving the clock) while it is full
+  class MockStream : public Stream {
+  public:
+    std::deque<uint8_t> input; // bytes waiting to be read by the library
+    std::string output; // everything the library has written
+
+    unsigned long writeCalls = 0; // number of write() calls (transactions)
+    unsigned long bytesRead = 0; // number of bytes the library has read
+    int txSpace = 4096; // value reported by availableForWrite() (unless txMicrosPerByte is set)
+
+    int rxFifoSize = 0; // bytes the receive FIFO holds (0 = unlimited); only applies to scheduled bytes
+    unsigned long droppedBytes = 0; // scheduled bytes which arrived while the FIFO was full
+    int rxHighWater = 0; // most bytes ever waiting in the FIFO
+
+    unsigned long txMicrosPerByte = 0; // time to send a byte (0 = instant)
+    int txFifoSize = 64; // bytes the transmit buffer holds
+    unsigned long long txBlockedMicros = 0; // time write() spent waiting for room
+
+    void begin(unsigned long baud) {}
+
+    // queues text to be read by the library
+    void feed(const char *text) { while (*text) input.push_back((uint8_t)*text++); }
+    void feed(const char *data, size_t length) { input.insert(input.end(), data, data + length); }
+    void feed(char c) { input.push_back((uint8_t)c); }
+
+    // makes bytes arrive one after another, the first at startMicros (on the virtual clock)
+    void schedule(const char *data, size_t length, unsigned long long startMicros, double microsPerByte) {
+      for (size_t i = 0; i < length; i++) arriving.push_back({startMicros + (unsigned long long)(i * microsPerByte), (uint8_t)data[i]});
+    }
+
+    // whether scheduled bytes are still to arrive
+    bool arrivalsPending() const { return !arriving.empty(); }
+
+    // clears captured output and counters
+    void clearOutput() { output.clear(); writeCalls = 0; }
+
+    int available() override { receiveArrived(); return (int)input.size(); }
+
+    int read() override {
+      receiveArrived();
+      if (input.empty()) return -1;
+      uint8_t value = input.front();
+      input.pop_front();
+      bytesRead++;
+      return value;
+    }
+
+    int peek() override { receiveArrived(); return input.empty() ? -1 : input.front(); }
+
+    size_t write(uint8_t value) override {
+      writeCalls++;
+      transmit(1);
+      output.push_back((char)value);
+      return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+      writeCalls++;
+      transmit(size);
+      output.append((const char *)buffer, size);
+      return size;
+    }
+
+    int availableForWrite() override {
+      if (!txMicrosPerByte) return txSpace;
+      if (txQueued() >= txFifoSize) mockMicros += 1; // someone is waiting for room; the check itself takes time
+      return txFifoSize - txQueued();
+    }
+
+  private:
+    struct Arrival { unsigned long long micros; uint8_t value; };
+    std::deque<Arrival> arriving; // scheduled bytes, in order of arrival
+    unsigned long long txDoneMicros = 0; // when everything written so far has been sent
+
+    // moves the scheduled bytes which have arrived by now into the FIFO
+    // nothing is read between arrivals handled here, so doing it late gives the same drops as doing it on time
+    void receiveArrived() {
+      while (!arriving.empty() && arriving.front().micros <= mockMicros) {
+        if (rxFifoSize && (int)input.size() >= rxFifoSize) droppedBytes++;
+        else input.push_back(arriving.front().value);
+        arriving.pop_front();
+        if ((int)input.size() > rxHighWater) rxHighWater = (int)input.size();
+      }
+    }
+
+    // bytes written but not sent yet
+    int txQueued() {
+      if (txDoneMicros <= mockMicros) return 0;
+      return (int)((txDoneMicros - mockMicros + txMicrosPerByte - 1) / txMicrosPerByte);
+    }
+
+    // queues bytes for sending, waiting for room like a blocking UART driver
+    void transmit(size_t size) {
+      if (!txMicrosPerByte) return;
+
+      for (size_t i = 0; i < size; i++) {
+        if (txQueued() >= txFifoSize) {
+          unsigned long long roomMicros = txDoneMicros - (unsigned long long)(txFifoSize - 1) * txMicrosPerByte;
+          txBlockedMicros += roomMicros - mockMicros;
+          mockMicros = roomMicros;
+        }
+        txDoneMicros = (txDoneMicros > mockMicros ? txDoneMicros : mockMicros) + txMicrosPerByte;
+      }
+    }
+  };
+
+
+  MockStream Serial;
+  MockStream Serial1;
+//
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Host-side stand-in for ONC_EEPROM.h
+ *
+ * Backs eepromGet()/eepromPut() with a RAM array and counts every access,
+ * so the EEPROM traffic caused by each console command can be measured.
+ * Writes are also counted per byte (for wear), and can be cut off part way to simulate a power loss.
+*/
+
+
+#ifndef HOST_ONC_EEPROM_h
+#define HOST_ONC_EEPROM_h
+
+  #ifndef MOCK_EEPROM_SIZE
+  #define MOCK_EEPROM_SIZE 4096 // bytes of simulated EEPROM
+  #endif
+
+
+  // access counters, cleared with eepromResetCounters()
+  struct MockEepromCounters {
+    unsigned long reads; // eepromGet() calls (one bus transaction each)
+    unsigned long writes; // eepromPut() calls (one write cycle each)
+    unsigned long bytesRead;
+    unsigned long bytesWritten;
+    unsigned long blockWrites; // eepromWriteBlock() calls (one page write cycle each)
+  };
+
+
+  uint8_t mockEeprom[MOCK_EEPROM_SIZE]; // simulated EEPROM contents
+  MockEepromCounters eepromCounters = {0, 0, 0, 0, 0};
+
+  unsigned long mockEepromCellWrites[MOCK_EEPROM_SIZE]; // times each byte has been written (wear)
+  long mockEepromWritesLeft = -1; // bytes written before the power is cut (later writes are lost); -1 = no limit
+
+
+  void eepromResetCounters() { eepromCounters = MockEepromCounters{0, 0, 0, 0, 0}; }
+
+
+  // the most times any one byte has been written
+  unsigned long eepromMostCellWrites() {
+    unsigned long most = 0;
+    for (int i = 0; i < MOCK_EEPROM_SIZE; i++) if (mockEepromCellWrites[i] > most) most = mockEepromCellWrites[i];
+    return most;
+  }
+
+
+  // stores bytes, as far as the power lasts
+  void mockEepromWrite(int address, const uint8_t *data, int length) {
+    for (int i = 0; i < length && mockEepromWritesLeft != 0; i++) {
+      mockEeprom[address + i] = data[i];
+      mockEepromCellWrites[address + i]++;
+      if (mockEepromWritesLeft > 0) mockEepromWritesLeft--;
+    }
+  }
+
+  bool eepromBegin() { return true; }
+
+
+  // reads a value from the simulated EEPROM
+  template <typename T> T &eepromGet(int address, T &value) {
+    memcpy(&value, &mockEeprom[address], sizeof(T));
+    eepromCounters.reads++;
+    eepromCounters.bytesRead += sizeof(T);
+    return value;
+  }
+
+
+  // writes a value to the simulated EEPROM
+  template <typename T> const T &eepromPut(int address, const T &value) {
+    mockEepromWrite(address, (const uint8_t *)&value, sizeof(T));
+    eepromCounters.writes++;
+    eepromCounters.bytesWritten += sizeof(T);
+    return value;
+  }
+
+
+  // writes a block of bytes in one write cycle, as a page write on an I2C EEPROM would
+  // builds with USE_EEPROM_WRITE_BACK can pass it as EEPROM_WRITE_BLOCK
+  void eepromWriteBlock(int address, const uint8_t *data, int length) {
+    mockEepromWrite(address, data, length);
+    eepromCounters.blockWrites++;
+    eepromCounters.bytesWritten += length;
+  }
+
+
+  // the examples start the I2C bus before the EEPROM
+  struct MockWire { void begin() {} } Wire;
+
+#endif
@@ -0,0 +1,447 @@
+/*
+ * Host benchmark for ONC_ConsoleControl.h
+ *
+ * Drives the console through the scripted Serial1 in Arduino.h and reports, for the
+ * configuration it was compiled with (MAX_COMMANDS, INPUT_BUFFER_SIZE, COMMAND_HISTORY_LENGTH):
+ *   - keystroke-to-echo cost of the line editor operations
+ *   - command dispatch cost
+ *   - bytes and write() calls emitted per edit operation
+ *   - EEPROM accesses per command (and, with USE_EEPROM_WRITE_BACK, the writes saved by the write-back cache)
+ *   - EEPROM wear (most writes to one byte), and with USE_EEPROM_LOG the log's write amplification and index rebuild cost
+ *   - with USE_CONSOLE_STATS, what the statistics themselves cost (compare with the default configuration)
+ *
+ * Times are host nanoseconds; they are for comparing builds with each other, not for predicting MCU timings.
+ * Build and run through the Makefile in extras/host ("make bench").
+*/
+
+
+#define SERIAL_INTERFACE Serial1
+
+#include <ONC_ConsoleControl.h>
+
+#include <chrono>
+
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 2000 // repetitions of each measured operation
+#endif
+
+#define ESC "\x1b"
+
+
+/* -- -- -- -- -- -- Measurement helpers -- -- -- -- -- -- */
+
+  // totals for one measured operation
+  struct BenchResult {
+    const char* name;
+    unsigned long runs;
+    double nanoseconds; // host time spent in consolePoll()
+    unsigned long bytes; // bytes written to the serial port
+    unsigned long writes; // write() calls made on the serial port
+    unsigned long eepromReads;
+    unsigned long eepromWrites; // eepromPut() calls and block writes
+  };
+
+
+  BenchResult results[32];
+  int resultNum = 0;
+
+
+  // starts a new result row
+  BenchResult &beginResult(const char* name) {
+    BenchResult &result = results[resultNum++];
+    result = BenchResult{name, 0, 0, 0, 0, 0, 0};
+    return result;
+  }
+
+
+  // feeds bytes to the console and runs consolePoll() until they are consumed, leaving enough quiet time for escape sequences to finish
+  // the time, output and eeprom traffic of the polls are added to result if given
+  // length is only needed if keys contains null bytes
+  void sendKeys(const char* keys, BenchResult* result = NULL, size_t length = 0) {
+
+    Serial1.feed(keys, length ? length : strlen(keys));
+
+    size_t outputStart = Serial1.output.size();
+    unsigned long writeStart = Serial1.writeCalls;
+    MockEepromCounters eepromStart = eepromCounters;
+
+    auto start = std::chrono::steady_clock::now();
+
+    consolePoll();
+    mockAdvanceMicros((ESC_CODE_MS + 1) * 1000UL);
+    consolePoll();
+
+    auto end = std::chrono::steady_clock::now();
+
+    if (result) {
+      result->runs++;
+      result->nanoseconds += std::chrono::duration<double, std::nano>(end - start).count();
+      result->bytes += Serial1.output.size() - outputStart;
+      result->writes += Serial1.writeCalls - writeStart;
+      result->eepromReads += eepromCounters.reads - eepromStart.reads;
+      result->eepromWrites += eepromCounters.writes + eepromCounters.blockWrites - eepromStart.writes - eepromStart.blockWrites;
+    }
+
+    if (Serial1.output.size() > 1 << 20) Serial1.clearOutput(); // keep the capture from growing without bound
+  }
+
+
+  // sends a key sequence repeatedly, as a pair of operations which undo each other
+  void measurePair(const char* name, const char* keys, const char* undoName, const char* undoKeys) {
+    BenchResult &result = beginResult(name);
+    BenchResult &undoResult = beginResult(undoName);
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+      sendKeys(keys, &result);
+      sendKeys(undoKeys, &undoResult);
+    }
+  }
+
+
+  // runs a command line repeatedly, measuring only the consolePoll() call which dispatches it (and those printing its listing, if it starts one)
+  // setup lines, if given, are run before each repetition (not measured)
+  void measureCommand(const char* name, const char* line, const char* const* setup = NULL, int setupNum = 0) {
+    BenchResult &result = beginResult(name);
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+      for (int j = 0; j < setupNum; j++) sendKeys(setup[j]);
+
+      Serial1.feed(line);
+      while (!defaultConsole.lineReady) consolePoll();
+
+      size_t outputStart = Serial1.output.size();
+      unsigned long writeStart = Serial1.writeCalls;
+      MockEepromCounters eepromStart = eepromCounters;
+
+      auto start = std::chrono::steady_clock::now();
+      do consolePoll(); while (defaultConsole.listing.printLine);
+      auto end = std::chrono::steady_clock::now();
+
+      result.runs++;
+      result.nanoseconds += std::chrono::duration<double, std::nano>(end - start).count();
+      result.bytes += Serial1.output.size() - outputStart;
+      result.writes += Serial1.writeCalls - writeStart;
+      result.eepromReads += eepromCounters.reads - eepromStart.reads;
+      result.eepromWrites += eepromCounters.writes + eepromCounters.blockWrites - eepromStart.writes - eepromStart.blockWrites;
+    }
+  }
+
+
+  // types a string one key at a time (not measured)
+  void typeText(const char* text) {
+    char key[2] = {0, 0};
+    for (; *text; text++) {
+      key[0] = *text;
+      sendKeys(key);
+    }
+  }
+
+
+  // clears the line being edited (not measured)
+  void clearLine() {
+    for (int i = 0; i < INPUT_BUFFER_SIZE; i++) sendKeys(ESC "[C");
+    for (int i = 0; i < INPUT_BUFFER_SIZE; i++) sendKeys("\b");
+  }
+
+
+  #ifdef USE_BINARY_PROTOCOL
+  // sends a binary protocol request repeatedly (the console must be in binary mode)
+  void measureFrame(const char* name, const uint8_t* payload, uint8_t length) {
+    char frame[BINARY_FRAME_SIZE + 4];
+    uint16_t crc = crc16(payload, length, crc16(&length, 1));
+
+    frame[0] = (char)BINARY_FRAME_START;
+    frame[1] = length;
+    memcpy(&frame[2], payload, length);
+    frame[length + 2] = crc & 0xFF;
+    frame[length + 3] = crc >> 8;
+
+    printf("%s: %d request bytes\n", name, length + 4);
+
+    BenchResult &result = beginResult(name);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) sendKeys(frame, &result, length + 4);
+  }
+  #endif
+
+
+  void printResults() {
+    printf("%-28s %12s %10s %10s %10s %10s\n", "operation", "ns/op", "bytes/op", "writes/op", "ee rd/op", "ee wr/op");
+
+    for (int i = 0; i < resultNum; i++) {
+      BenchResult &r = results[i];
+      double runs = r.runs ? r.runs : 1;
+      printf("%-28s %12.0f %10.1f %10.1f %10.2f %10.2f\n", r.name, r.nanoseconds / runs, r.bytes / runs, r.writes / runs, r.eepromReads / runs, r.eepromWrites / runs);
+    }
+  }
+//
+
+
+
+
+/* -- -- -- -- -- -- Commands used by the benchmark -- -- -- -- -- -- */
+
+void noop(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {}
+
+void fillerCommand(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) {}
+
+#ifdef USE_CONSOLE_JOBS
+// job which yields on every step until cancelled
+JobStatus spinJob(Job &job) {
+  JOB_BEGIN(job);
+  while (!job.cancelled) JOB_YIELD(job);
+  JOB_END(job);
+}
+#endif
+
+char fillerNames[MAX_COMMANDS][20]; // names of the commands registered to fill the command list
+
+
+// compile-time command table, searched before the registered commands
+COMMAND_TABLE(benchCommandTable) = {
+  {"@table00","table command","@table00",2,0,&noop},
+  {"@table01","table command","@table01",2,0,&noop},
+  {"@table02","table command","@table02",2,0,&noop},
+  {"@table03","table command","@table03",2,0,&noop},
+  {"@table04","table command","@table04",2,0,&noop},
+  {"@table05","table command","@table05",2,0,&noop},
+  {"@table06","table command","@table06",2,0,&noop},
+  {"@table07","table command","@table07",2,0,&noop},
+  {"@table08","table command","@table08",2,0,&noop},
+  {"@table09","table command","@table09",2,0,&noop},
+  {"@table10","table command","@table10",2,0,&noop},
+  {"@table11","table command","@table11",2,0,&noop},
+  {"@table12","table command","@table12",2,0,&noop},
+  {"@table13","table command","@table13",2,0,&noop},
+  {"@table14","table command","@table14",2,0,&noop},
+  {"@table15","table command","@table15",2,0,&noop},
+  {"@table16","table command","@table16",2,0,&noop},
+  {"@table17","table command","@table17",2,0,&noop},
+  {"@table18","table command","@table18",2,0,&noop},
+  {"@table19","table command","@table19",2,0,&noop},
+  {"@table20","table command","@table20",2,0,&noop},
+  {"@table21","table command","@table21",2,0,&noop},
+  {"@table22","table command","@table22",2,0,&noop},
+  {"@table23","table command","@table23",2,0,&noop},
+  {"@table24","table command","@table24",2,0,&noop},
+  {"@table25","table command","@table25",2,0,&noop},
+  {"@table26","table command","@table26",2,0,&noop},
+  {"@table27","table command","@table27",2,0,&noop},
+  {"@table28","table command","@table28",2,0,&noop},
+  {"@table29","table command","@table29",2,0,&noop},
+  {"@table30","table command","@table30",2,0,&noop},
+  {"@table31","table command","@table31",2,0,&noop},
+  {"@table32","table command","@table32",2,0,&noop},
+  {"@table33","table command","@table33",2,0,&noop},
+  {"@table34","table command","@table34",2,0,&noop},
+  {"@table35","table command","@table35",2,0,&noop},
+  {"@table36","table command","@table36",2,0,&noop},
+  {"@table37","table command","@table37",2,0,&noop},
+  {"@table38","table command","@table38",2,0,&noop},
+  {"@table39","table command","@table39",2,0,&noop},
+  {"@table40","table command","@table40",2,0,&noop},
+  {"@table41","table command","@table41",2,0,&noop},
+  {"@table42","table command","@table42",2,0,&noop},
+  {"@table43","table command","@table43",2,0,&noop},
+  {"@table44","table command","@table44",2,0,&noop},
+  {"@table45","table command","@table45",2,0,&noop},
+  {"@table46","table command","@table46",2,0,&noop},
+  {"@table47","table command","@table47",2,0,&noop},
+  {"@table48","table command","@table48",2,0,&noop},
+  {"@table49","table command","@table49",2,0,&noop},
+  {"@table50","table command","@table50",2,0,&noop},
+  {"@table51","table command","@table51",2,0,&noop},
+  {"@table52","table command","@table52",2,0,&noop},
+  {"@table53","table command","@table53",2,0,&noop},
+  {"@table54","table command","@table54",2,0,&noop},
+  {"@table55","table command","@table55",2,0,&noop},
+  {"@table56","table command","@table56",2,0,&noop},
+  {"@table57","table command","@table57",2,0,&noop},
+  {"@table58","table command","@table58",2,0,&noop},
+  {"@table59","table command","@table59",2,0,&noop},
+  {"@table60","table command","@table60",2,0,&noop},
+  {"@table61","table command","@table61",2,0,&noop},
+  {"@table62","table command","@table62",2,0,&noop},
+  {"@table63","table command","@table63",2,0,&noop},
+};
+//
+
+
+
+
+int main() {
+
+  registerCommandTable(benchCommandTable);
+  registerDefaultCommands();
+
+  #ifdef USE_CONSOLE_JOBS
+  registerJob(F("@spin"),F("yields until cancelled"),F("@spin"),0,0,&spinJob);
+  #endif
+
+  // fill the command list so the measured command is the last one searched
+  while (commandNum < MAX_COMMANDS - 1) {
+    snprintf(fillerNames[commandNum], sizeof(fillerNames[0]), "@filler%d", commandNum);
+    registerCommand({fillerNames[commandNum],"filler","@filler",2,0,&fillerCommand});
+  }
+  registerCommand({"@noop","does nothing","@noop"DELIMITER"(<a>)"DELIMITER"(<b>)",2,0,&noop});
+
+  registerVariable({"gain",1,0});
+  registerVariable({"mode",0,8});
+
+
+  printf("== config: MAX_COMMANDS=%d INPUT_BUFFER_SIZE=%d COMMAND_HISTORY_LENGTH=%d MAX_PARAMETERS=%d ==\n",
+    MAX_COMMANDS, INPUT_BUFFER_SIZE, COMMAND_HISTORY_LENGTH, MAX_PARAMETERS);
+
+
+  sendKeys("\r"); // start the console session
+
+
+  // -- line editor -- //
+
+  // half-filled line with the cursor at the end
+  typeText("@noop,");
+  for (int i = 6; i < INPUT_BUFFER_SIZE / 2; i++) sendKeys("a");
+
+  measurePair("append char", "x", "backspace at end", "\b");
+  measurePair("cursor left", ESC "[D", "cursor right", ESC "[C");
+
+  for (int i = 0; i < INPUT_BUFFER_SIZE / 4; i++) sendKeys(ESC "[D"); // move to the middle of the line
+
+  measurePair("insert mid-line", "x", "backspace mid-line", "\b");
+
+  clearLine();
+
+  #ifndef NO_TAB_COMPLETION
+  typeText("@no");
+  measurePair("tab complete @no", "\t", "backspace x2", "\b\b");
+  clearLine();
+  #endif
+  sendKeys("\r");
+
+
+  // -- history -- //
+
+  for (int i = 0; i < COMMAND_HISTORY_LENGTH; i++) {
+    char entry[32];
+    snprintf(entry, sizeof(entry), "@noop,history,entry%d", i);
+    typeText(entry);
+    sendKeys("\r");
+  }
+
+  measurePair("history up", ESC "[A", "history down", ESC "[B");
+
+  sendKeys(ESC "[A"); // scroll between two entries which differ in one character
+  measurePair("history up, similar entry", ESC "[A", "history down, similar", ESC "[B");
+  sendKeys(ESC "[B");
+
+
+  // -- dispatch -- //
+
+  measureCommand("dispatch @noop (last)", "@noop\r");
+  measureCommand("dispatch @noop,a,b", "@noop,a,b\r");
+  measureCommand("dispatch table command", "@table41\r");
+  measureCommand("dispatch unknown command", "@missing\r");
+  measureCommand("dispatch @help", "@help\r");
+
+
+  #ifdef USE_CONSOLE_JOBS
+  // editing while a job takes a step on every poll, then stopping it
+  sendKeys("@spin\r");
+  typeText("@noop,");
+  measurePair("append char, job running", "x", "backspace, job running", "\b");
+  measurePair("ctrl-c job, restart", "\x03", "start job @spin", "@spin\r");
+  sendKeys("\x03");
+  clearLine();
+  #endif
+
+
+  // -- eeprom -- //
+
+  measureCommand("@get,gain", "@get,gain\r");
+  measureCommand("@put,gain,1.5", "@put,gain,1.5\r");
+  measureCommand("@variables", "@variables\r");
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  // several puts to neighbouring variables, then one commit
+  const char* const puts[] = {"@put,gain,2.5\r", "@put,gain,3.5\r", "@put,mode,3\r", "@put,gain,1.5\r", "@put,mode,4\r"};
+  measureCommand("@commit (after 5 puts)", "@commit\r", puts, 5);
+  #endif
+
+  #ifdef USE_VARIABLE_IMAGE
+  measureCommand("@dump", "@dump\r");
+  #endif
+
+  #ifdef USE_CONSOLE_ALIASES
+  // a 6 command procedure entered as one alias, compared with typing it out
+  const char* procedure[] = {"@put,gain,2.5;@put,mode,3;@get,gain", "@get,mode;@noop,a,b;@put,gain,1.5"};
+  unsigned long procedureBytes = 0;
+  for (const char* commands : procedure) {
+    char line[INPUT_BUFFER_SIZE + 1];
+    snprintf(line, sizeof(line), "@alias,prep,\"%s\"\r", commands);
+    sendKeys(line);
+    procedureBytes += strlen(commands) + 1;
+  }
+
+  measureCommand("alias prep (6 commands)", "prep\r");
+  #endif
+
+
+  #ifdef USE_BINARY_PROTOCOL
+  // the same eeprom operations through the binary protocol (compare the bytes with the rows above)
+  sendKeys("@binary\r");
+
+  const uint8_t binaryGet[] = {1, BINARY_GET, 0};
+  const uint8_t binaryPut[] = {2, BINARY_PUT, 0, BINARY_FLOAT, 0x00, 0x00, 0xC0, 0x3F}; // 1.5
+  const uint8_t binaryBatch[] = {3, BINARY_GET, 0, BINARY_GET, 1, BINARY_PUT, 1, BINARY_BYTE, 4, BINARY_PUT, 0, BINARY_FLOAT, 0x00, 0x00, 0xC0, 0x3F};
+  const uint8_t binaryCall[] = {4, BINARY_CALL, (uint8_t)findCommandIndex("@noop"), 2, BINARY_STRING, 1, 'a', BINARY_INT, 2, 0, 0, 0};
+
+  measureFrame("binary get gain", binaryGet, sizeof(binaryGet));
+  measureFrame("binary put gain", binaryPut, sizeof(binaryPut));
+  measureFrame("binary 2 gets + 2 puts", binaryBatch, sizeof(binaryBatch));
+  measureFrame("binary call @noop,a,2", binaryCall, sizeof(binaryCall));
+  #endif
+
+  printResults();
+
+  printf("output writer: %lu flushes, %lu bytes, %lu blocking flushes (buffer full)\n",
+    defaultConsole.output.flushes, defaultConsole.output.bytesSent, defaultConsole.output.blockingFlushes);
+
+  #ifdef USE_EEPROM_WRITE_BACK
+  printf("write-back cache: %lu puts, %lu EEPROM writes, %lu writes saved\n",
+    writeBackStats.puts, writeBackStats.eepromWrites, writeBackStats.writesSaved);
+  #endif
+
+  printf("eeprom wear: %lu writes to the most written byte\n", eepromMostCellWrites());
+
+  #ifdef USE_CONSOLE_ALIASES
+  printf("alias: \"prep\\r\" (5 bytes) instead of %lu bytes typed, stored in %d bytes of eeprom\n", procedureBytes, aliasBytesUsed());
+  #endif
+
+  #ifdef USE_EEPROM_LOG
+  printf("eeprom log: %lu records, %lu value bytes, %lu log bytes (write amplification %.2f), %lu compactions, %lu bytes copied\n",
+    eepromLogStats.records, eepromLogStats.valueBytes, eepromLogStats.logBytes,
+    eepromLogStats.valueBytes ? (double)eepromLogStats.logBytes / eepromLogStats.valueBytes : 0.0, eepromLogStats.compactions, eepromLogStats.copiedBytes);
+
+  // what a reset costs: scanning the log again
+  eepromResetCounters();
+  auto rebuildStart = std::chrono::steady_clock::now();
+  rebuildEepromLog();
+  auto rebuildEnd = std::chrono::steady_clock::now();
+
+  printf("index rebuild at boot: %u records, %lu eeprom reads (%lu bytes), %.0f host ns\n",
+    eepromLogStats.rebuildRecords, eepromCounters.reads, eepromCounters.bytesRead,
+    std::chrono::duration<double, std::nano>(rebuildEnd - rebuildStart).count());
+  #endif
+
+  #ifdef USE_CONSOLE_JOBS
+  printf("jobs: %d bytes of RAM for %d job slots\n", (int)sizeof(jobs), MAX_JOBS);
+  #endif
+
+  #ifdef USE_CONSOLE_STATS
+  CommandStats* noopStats = findCommandStats(findCommandIndex("@noop"));
+  printf("console stats: %lu keystrokes, %lu unknown commands, %lu line redraws (%lu bytes), @noop ran %lu times\n",
+    consoleStats.keystrokes, consoleStats.unknownCommands, consoleStats.redraws, consoleStats.redrawBytes, noopStats ? noopStats->calls : 0);
+  #endif
+
+  return 0;
+}
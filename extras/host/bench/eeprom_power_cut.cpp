@@ -0,0 +1,152 @@
+/*
+ * Power-cut check for the EEPROM log of ONC_ConsoleControl.h (USE_EEPROM_LOG)
+ *
+ * Commits random changes to a set of variables, and cuts the power (mockEepromWritesLeft in ONC_EEPROM.h)
+ * at a random byte, either part way through a commit or part way through the compaction which follows it.
+ * After each cut the RAM state is thrown away as on a reset, the log is rebuilt, and every variable is compared:
+ *   - a commit cut off part way must leave either all or none of its values
+ *   - anything committed before, including values being copied by compaction, must survive
+ * Finally it checks that a variable registered after the log was first read still gets its stored value.
+ *
+ * The segments are small, so compaction runs every few commits.
+ * The program fails (exit code 1) on any mismatch. Build and run through the Makefile in extras/host ("make powercut").
+*/
+
+
+#define USE_EEPROM_LOG
+#define USE_EEPROM_WRITE_BACK
+#define EEPROM_WRITE_BLOCK eepromWriteBlock
+
+#ifndef EEPROM_LOG_SEGMENT_SIZE
+#define EEPROM_LOG_SEGMENT_SIZE 96
+#endif
+
+#ifndef CUTS
+#define CUTS 5000 // commits, each with a power cut
+#endif
+
+#include <ONC_ConsoleControl.h>
+
+
+#define VARIABLE_COUNT 8 // the first half are doubles, the rest bytes
+
+char variableNames[VARIABLE_COUNT][4];
+VariableValue committed[VARIABLE_COUNT]; // what each variable should read after a reset
+
+
+// registers the variables in order (leaving out the last if all is false)
+void registerVariables(bool all) {
+  for (int i = 0; i < VARIABLE_COUNT - (all ? 0 : 1); i++) {
+    snprintf(variableNames[i], sizeof(variableNames[i]), "v%d", i);
+    registerVariable({variableNames[i], (uint8_t)(i < VARIABLE_COUNT / 2 ? 1 : 0), i * 8});
+  }
+}
+
+
+// throws away everything the library keeps in RAM, as a reset would (the variables stay registered)
+void reset() {
+  logReady = false;
+  memset(loadedVariables, 0, sizeof(loadedVariables));
+  memset(pendingVariables, 0, sizeof(pendingVariables));
+  memset(variableValues, 0, sizeof(variableValues));
+  writeBackStats.pendingBytes = 0;
+  pendingPuts = 0;
+}
+
+
+bool sameValue(int variableIndex, const VariableValue &a, const VariableValue &b) {
+  return memcmp(a.bytes, b.bytes, typeSizes[variables[variableIndex].type]) == 0;
+}
+
+
+// a new value for a variable, different for every commit
+VariableValue makeValue(int variableIndex, int commit) {
+  VariableValue value;
+  memset(&value, 0, sizeof(value));
+  if (variables[variableIndex].type == 1) value.asDouble = commit + variableIndex * 0.25;
+  else value.asByte = (uint8_t)(commit * 7 + variableIndex);
+  return value;
+}
+
+
+int main() {
+  registerVariables(true);
+  srand(1);
+
+  int failures = 0;
+  int commitCuts = 0, compactionCuts = 0, commitsLost = 0;
+
+  for (int commit = 1; commit <= CUTS; commit++) {
+    bool cutCommit = commit % 2 == 0; // otherwise the cut comes during the compaction after the commit
+
+    // change some of the variables
+    bool changed[VARIABLE_COUNT] = {};
+    VariableValue values[VARIABLE_COUNT];
+    int changes = 0;
+    while (changes == 0) {
+      for (int i = 0; i < VARIABLE_COUNT; i++) {
+        changed[i] = rand() % 3 == 0;
+        changes += changed[i];
+      }
+    }
+
+    for (int i = 0; i < VARIABLE_COUNT; i++) {
+      if (!changed[i]) continue;
+      values[i] = makeValue(i, commit);
+      writeVariable(i, values[i]);
+    }
+
+    if (cutCommit) mockEepromWritesLeft = rand() % 40;
+    commitVariables();
+
+    if (!cutCommit) mockEepromWritesLeft = rand() % 40;
+    while (stepEepromLog()) {}
+
+    bool cut = mockEepromWritesLeft == 0;
+    mockEepromWritesLeft = -1;
+    if (cut) (cutCommit ? commitCuts : compactionCuts)++;
+
+    reset();
+
+    // the commit must be there whole, or (if the power was cut during it) not at all
+    int newValues = 0;
+    for (int i = 0; i < VARIABLE_COUNT; i++) if (changed[i] && sameValue(i, readVariable(i), values[i])) newValues++;
+
+    bool kept = newValues == changes;
+    if (!kept && (newValues > 0 || !cutCommit || !cut)) {
+      if (failures++ < 10) printf("commit %d: %d of its %d values survived (power cut %s)\n", commit, newValues, changes, cut ? (cutCommit ? "during the commit" : "during compaction") : "never");
+      kept = true;
+    }
+    if (!kept) commitsLost++;
+
+    for (int i = 0; i < VARIABLE_COUNT; i++) {
+      VariableValue expected = changed[i] && kept ? values[i] : committed[i];
+
+      if (!sameValue(i, readVariable(i), expected)) {
+        if (failures++ < 10) printf("commit %d: %s lost its value (power cut %s)\n", commit, variables[i].name, cut ? (cutCommit ? "during the commit" : "during compaction") : "never");
+      }
+
+      committed[i] = readVariable(i);
+    }
+  }
+
+
+  // a variable registered after the log has been read must still find its value
+  variableNum = 0;
+  reset();
+  registerVariables(false);
+  readVariable(0);
+  registerVariables(true); // (the others are rejected as duplicates)
+
+  int last = VARIABLE_COUNT - 1;
+  if (!sameValue(last, readVariable(last), committed[last])) {
+    printf("a variable registered after the log was read lost its value\n");
+    failures++;
+  }
+
+
+  printf("%d commits: power cut during %d commits (%d lost whole) and %d compactions, %lu writes to the most written byte\n",
+    CUTS, commitCuts, commitsLost, compactionCuts, eepromMostCellWrites());
+  printf(failures ? "%d mismatch(es) after a power cut\n" : "every variable survived every power cut\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Paste-burst and soak simulator for ONC_ConsoleControl.h
+ *
+ * Feeds the console timed byte streams through the UART model of the scripted Serial1 in Arduino.h
+ * (bytes arrive at the baud rate into a finite receive FIFO, and output drains at the same rate),
+ * while a simulated loop() calls consolePoll() and then does LOOP_WORK_US of other work.
+ * The MCU's own processing time is modelled with fixed costs per poll, per byte read and per byte written,
+ * so every run gives the same figures.
+ *
+ * For each scenario and baud rate it reports:
+ *   - bytes dropped by the receive FIFO, and bytes lost by the library's receive buffer
+ *   - high-water marks of both
+ *   - worst-case processing time per byte read (virtual time of a consolePoll() / bytes it read)
+ *   - @noop commands run out of those sent (the ones lost are limited too)
+ *   - the longest single consolePoll() in virtual time (how long loop() was held up), for information
+ *   - host nanoseconds per byte, for information only
+ *
+ * It is a regression suite: each scenario has limits, set just above what the library does today,
+ * and the program fails (exit code 1) if any is exceeded. Lower a limit when a change improves on it.
+ * Build and run through the Makefile in extras/host ("make soak").
+*/
+
+
+#define SERIAL_INTERFACE Serial1
+
+#include <ONC_ConsoleControl.h>
+
+#include <chrono>
+
+
+#ifndef RX_FIFO_SIZE
+#define RX_FIFO_SIZE 64 // bytes the UART receive FIFO / driver buffer holds
+#endif
+
+#ifndef TX_FIFO_SIZE
+#define TX_FIFO_SIZE 64 // bytes the UART transmit buffer holds
+#endif
+
+#ifndef LOOP_WORK_US
+#define LOOP_WORK_US 500 // time the rest of loop() takes between consolePoll() calls
+#endif
+
+// processing cost on the MCU, roughly a 16 MHz AVR
+#ifndef POLL_COST_US
+#define POLL_COST_US 10 // fixed cost of a consolePoll() call
+#endif
+
+#ifndef READ_COST_US
+#define READ_COST_US 20 // handling one received byte (editing and echo bookkeeping)
+#endif
+
+#ifndef WRITE_COST_US
+#define WRITE_COST_US 2 // putting one byte of output into the buffers
+#endif
+
+#define ESC "\x1b"
+
+
+/* -- -- -- -- -- -- Commands -- -- -- -- -- -- */
+
+  unsigned long commandsRun = 0;
+
+  void noop(char (&parameters)[MAX_PARAMETERS][MAX_PARAMETER_LENGTH]) { commandsRun++; }
+//
+
+
+
+
+/* -- -- -- -- -- -- Simulation -- -- -- -- -- -- */
+
+  // figures for one scenario at one baud rate
+  struct SoakResult {
+    unsigned long bytesSent;
+    unsigned long droppedBytes; // lost in the receive FIFO
+    unsigned long ringOverflows; // lost in the library's receive buffer
+    int fifoHighWater;
+    int ringHighWater;
+    double worstMicrosPerByte; // virtual time
+    unsigned long commandsSent;
+    unsigned long commandsRun;
+    double worstPollMs; // longest consolePoll(), virtual time
+    double hostNanosPerByte;
+  };
+
+
+  // limits a scenario must stay within (at one baud rate)
+  struct SoakLimits {
+    unsigned long droppedBytes;
+    unsigned long ringOverflows;
+    int fifoHighWater;
+    double worstMicrosPerByte;
+    unsigned long commandsLost; // @noop commands sent but not run
+  };
+
+
+  // what is sent in a scenario
+  struct Scenario {
+    const char* name;
+    const char* setup; // typed slowly before the burst (may be empty)
+    const char* burst; // sent at full speed
+    int repeats; // how many times the burst is sent
+    int pauseMs; // pause after each burst (0 = back to back, like a paste)
+    SoakLimits limits[3]; // at each of the baud rates below
+  };
+
+
+  const unsigned long bauds[3] = {9600, 115200, 1000000};
+
+  unsigned long long worstPollMicros = 0; // longest consolePoll() (with its processing cost) since the scenario started
+
+
+  // runs one pass of the simulated loop(): consolePoll(), its processing cost, then the rest of loop()
+  // returns the virtual time per byte read if any were read, and adds the host time to hostNanos
+  double runLoop(double &hostNanos, unsigned long &bytesHandled) {
+    unsigned long readStart = Serial1.bytesRead;
+    size_t writeStart = Serial1.output.size();
+    unsigned long long pollStart = mockMicros;
+
+    auto start = std::chrono::steady_clock::now();
+    consolePoll();
+    auto end = std::chrono::steady_clock::now();
+
+    unsigned long bytesRead = Serial1.bytesRead - readStart;
+    unsigned long bytesWritten = Serial1.output.size() - writeStart;
+
+    mockAdvanceMicros(POLL_COST_US + bytesRead * READ_COST_US + bytesWritten * WRITE_COST_US);
+    double microsPerByte = bytesRead ? (double)(mockMicros - pollStart) / bytesRead : 0;
+    if (mockMicros - pollStart > worstPollMicros) worstPollMicros = mockMicros - pollStart;
+
+    hostNanos += std::chrono::duration<double, std::nano>(end - start).count();
+    bytesHandled += bytesRead;
+
+    if (Serial1.output.size() > 1 << 20) Serial1.clearOutput();
+
+    mockAdvanceMicros(LOOP_WORK_US);
+    return microsPerByte;
+  }
+
+
+  // ends the console session, so each scenario starts from a fresh line
+  void endSession() {
+    Serial1.feed(ESC);
+    double hostNanos = 0;
+    unsigned long bytesHandled = 0;
+    for (int i = 0; i < 20 || defaultConsole.consoleActive; i++) {
+      runLoop(hostNanos, bytesHandled);
+      mockAdvanceMicros(ESC_CODE_MS * 1000UL);
+      if (i > 1000) break;
+    }
+  }
+
+
+  // types text one key at a time, waiting for each to be handled (escape sequences are sent whole, as a terminal does)
+  void typeSlowly(const char* text) {
+    double hostNanos = 0;
+    unsigned long bytesHandled = 0;
+
+    while (*text) {
+      size_t length = 1;
+      if (*text == ESC[0]) while (text[length] && !isalpha(text[length++] & 0xFF)) {}
+
+      Serial1.feed(text, length);
+      text += length;
+
+      for (int i = 0; i < 5; i++) runLoop(hostNanos, bytesHandled);
+      mockAdvanceMicros((ESC_CODE_MS + 1) * 1000UL);
+    }
+  }
+
+
+  SoakResult runScenario(const Scenario &scenario, unsigned long baud) {
+    double byteMicros = 10e6 / baud; // 8N1: 10 bits per byte
+
+    endSession();
+    typeSlowly(scenario.setup);
+
+    Serial1.rxFifoSize = RX_FIFO_SIZE;
+    Serial1.txFifoSize = TX_FIFO_SIZE;
+    Serial1.txMicrosPerByte = (unsigned long)(byteMicros + 0.5);
+    Serial1.droppedBytes = 0;
+    Serial1.rxHighWater = 0;
+    worstPollMicros = 0;
+    defaultConsole.rxStats = {0, 0, 0};
+    defaultConsole.reportedOverflows = 0;
+    defaultConsole.output.echoSkipped = 0;
+    commandsRun = 0;
+
+    SoakResult result = {};
+
+    std::string burst = scenario.burst;
+    for (size_t at = burst.find("@noop"); at != std::string::npos; at = burst.find("@noop", at + 1)) result.commandsSent += scenario.repeats;
+
+    double arrivalMicros = mockMicros;
+    for (int i = 0; i < scenario.repeats; i++) {
+      Serial1.schedule(burst.data(), burst.size(), (unsigned long long)arrivalMicros, byteMicros);
+      arrivalMicros += burst.size() * byteMicros + scenario.pauseMs * 1000.0;
+    }
+    result.bytesSent = burst.size() * scenario.repeats;
+
+    double hostNanos = 0;
+    unsigned long bytesHandled = 0;
+
+    // run until everything has arrived and been handled, the last command has finished, and its output has been sent
+    // (so what is still being sent doesn't hold up the next scenario)
+    int quietLoops = 0;
+    while (quietLoops < 50) {
+      double microsPerByte = runLoop(hostNanos, bytesHandled);
+      if (microsPerByte > result.worstMicrosPerByte) result.worstMicrosPerByte = microsPerByte;
+
+      bool busy = Serial1.arrivalsPending() || Serial1.available() || defaultConsole.rxCount || defaultConsole.lineReady || defaultConsole.listing.printLine
+        || defaultConsole.output.pending() || Serial1.availableForWrite() < Serial1.txFifoSize;
+      quietLoops = busy ? 0 : quietLoops + 1;
+    }
+
+    result.droppedBytes = Serial1.droppedBytes;
+    result.ringOverflows = defaultConsole.rxStats.overflows;
+    result.fifoHighWater = Serial1.rxHighWater;
+    result.ringHighWater = defaultConsole.rxStats.highWater;
+    result.commandsRun = commandsRun;
+    result.worstPollMs = worstPollMicros / 1000.0;
+    result.hostNanosPerByte = bytesHandled ? hostNanos / bytesHandled : 0;
+
+    Serial1.rxFifoSize = 0;
+    Serial1.txMicrosPerByte = 0;
+
+    return result;
+  }
+//
+
+
+
+
+/* -- -- -- -- -- -- Scenarios -- -- -- -- -- -- */
+
+  // limits per baud rate (9600, 115200, 1000000): dropped bytes, ring overflows, FIFO high-water, worst us/byte, commands lost
+  // up to 115200 nothing may be lost; at 1000000 a byte arrives every 10 us but takes READ_COST_US (20 us) to handle,
+  // so a back-to-back paste outruns any console on the modelled MCU, and the limits there only keep the loss from growing
+  const Scenario scenarios[] = {
+    {"paste short commands", "", "@noop,abc,def\r", 40, 0,
+      {{0, 0, 3, 1353, 0}, {0, 0, 12, 80, 0}, {341, 154, 64, 43, 34}}},
+    {"paste long line", "", "@noop,aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r", 20, 0,
+      {{0, 0, 3, 43, 0}, {0, 0, 10, 43, 0}, {575, 256, 64, 43, 18}}},
+    {"paste ;-separated line", "", "@noop,a;@noop,b;@noop,c;@noop,d;@noop,e\r", 20, 0,
+      {{0, 0, 3, 43, 0}, {0, 0, 10, 43, 0}, {514, 227, 64, 43, 88}}},
+    {"insert mid-line", "@noop,end" ESC "[H", "xxxxxxxxxxxxxxxxxxxxxxxxxxxx", 1, 0,
+      {{0, 0, 3, 48, 0}, {0, 0, 10, 48, 0}, {0, 0, 29, 48, 0}}},
+    {"paste with @help output", "", "@help\r@noop\r", 5, 0,
+      {{0, 0, 3, 100, 0}, {0, 0, 9, 43, 0}, {0, 0, 55, 43, 0}}},
+    {"soak 1000 commands, 25ms", "", "@noop,1,2\r", 1000, 25,
+      {{0, 0, 3, 43, 0}, {0, 0, 9, 43, 0}, {0, 0, 12, 43, 0}}},
+  };
+//
+
+
+
+
+int main() {
+
+  registerDefaultCommands();
+  registerCommand({"@noop","does nothing","@noop"DELIMITER"(<a>)"DELIMITER"(<b>)",2,0,&noop});
+
+  printf("== serial soak: RX FIFO %d, TX FIFO %d, loop work %d us, cost per poll/read/write %d/%d/%d us ==\n",
+    RX_FIFO_SIZE, TX_FIFO_SIZE, LOOP_WORK_US, POLL_COST_US, READ_COST_US, WRITE_COST_US);
+  printf("%-24s %8s %7s %7s %7s %7s %7s %9s %11s %10s %9s\n",
+    "scenario", "baud", "sent", "dropped", "ring ov", "fifo hw", "ring hw", "us/byte", "commands", "worst poll", "host ns/b");
+
+  int failures = 0;
+
+  for (const Scenario &scenario : scenarios) {
+    for (int b = 0; b < 3; b++) {
+      SoakResult result = runScenario(scenario, bauds[b]);
+      const SoakLimits &limits = scenario.limits[b];
+
+      char commands[24];
+      snprintf(commands, sizeof(commands), "%lu/%lu", result.commandsRun, result.commandsSent);
+
+      printf("%-24s %8lu %7lu %7lu %7lu %7d %7d %9.1f %11s %8.1fms %9.0f\n",
+        scenario.name, bauds[b], result.bytesSent, result.droppedBytes, result.ringOverflows,
+        result.fifoHighWater, result.ringHighWater, result.worstMicrosPerByte, commands, result.worstPollMs, result.hostNanosPerByte);
+
+      if (result.droppedBytes > limits.droppedBytes || result.ringOverflows > limits.ringOverflows
+        || result.fifoHighWater > limits.fifoHighWater || result.worstMicrosPerByte > limits.worstMicrosPerByte
+        || result.commandsSent - result.commandsRun > limits.commandsLost) {
+        printf("  FAIL: over the limits (dropped %lu, ring overflows %lu, fifo high-water %d, %.1f us/byte, %lu commands lost)\n",
+          limits.droppedBytes, limits.ringOverflows, limits.fifoHighWater, limits.worstMicrosPerByte, limits.commandsLost);
+        failures++;
+      }
+    }
+  }
+
+  printf(failures ? "%d scenario(s) over their limits\n" : "all scenarios within their limits\n", failures);
+  return failures ? 1 : 0;
+}